@@ -0,0 +1,110 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include <chrono>
+#include <utility>
+#include <algorithm>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "MTBase64.hpp"
+
+
+
+/*Feel free to change, every measurement is the best of `kRounds` runs*/
+const int kRounds = 5;
+
+/*Best bandwidth of `codec` in MiB/s of input, counted over the decoded size
+for both directions so the numbers are comparable*/
+template <typename F>
+double MeasureBandwidth(std::size_t decoded_size, F codec) {
+  double best = 0;
+
+  for (int round = 0; round < kRounds; ++round) {
+    auto start = std::chrono::steady_clock::now();
+    codec();
+    std::chrono::duration<double> took = std::chrono::steady_clock::now() -
+                                         start;
+
+    best = std::max(best, decoded_size / took.count() / (1024 * 1024));
+  }
+
+  return best;
+}
+
+/*The example script, takes the buffer size in MiB (256 by default)*/
+int main(int argc, const char **argv) {
+  std::size_t size_mib = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 256;
+  if (size_mib == 0) {
+    std::cout << argv[0] << ": Not valid size: " << argv[1] << std::endl;
+    return -1;
+  }
+
+  std::size_t decoded_size = size_mib * 1024 * 1024;
+  std::size_t encoded_size = MTBase64::GetEncodedLength(decoded_size, true);
+
+  std::vector<uint8_t> decoded(decoded_size), encoded(encoded_size);
+  for (std::size_t i = 0; i < decoded_size; ++i)
+    decoded[i] = static_cast<uint8_t>(i * 167 + 13);
+
+  std::cout << "Kernel: " << MTBase64::GetKernelName() << ", buffer: "
+            << size_mib << " MiB, streaming threshold: "
+            << MTBase64::GetStreamingThreshold() / 1024 << " KiB" << std::endl;
+
+  const std::pair<const char*, MTBase64::StoreMode> modes[] = {
+    {"cached", MTBase64::StoreMode::kCached},
+    {"streaming", MTBase64::StoreMode::kStreaming}
+  };
+
+  /*The first pass faults the pages of the output buffers in*/
+  MTBase64::EncodeMem(encoded.data(), decoded.data(), decoded_size,
+                      MTBase64::kDefaultBase64);
+
+  for (const auto& mode : modes) {
+    double encode = MeasureBandwidth(decoded_size, [&]() {
+      MTBase64::EncodeMem(encoded.data(), decoded.data(), decoded_size,
+                          MTBase64::kDefaultBase64, true, mode.second);
+    });
+    double decode = MeasureBandwidth(decoded_size, [&]() {
+      MTBase64::DecodeMem(decoded.data(), encoded.data(), encoded_size,
+                          MTBase64::kDefaultBase64, true, mode.second);
+    });
+
+    std::cout << std::setw(10) << mode.first << ": encode "
+              << std::fixed << std::setprecision(1) << encode << " MiB/s, "
+              << "decode " << decode << " MiB/s" << std::endl;
+  }
+
+  /*Many small buffers, e.g. tokens and keys, once as a batch and once with a
+  call per buffer*/
+  for (std::size_t buffer_size : {16, 32, 48}) {
+    std::size_t count = std::min<std::size_t>(65536,
+                                              decoded_size / buffer_size);
+    std::vector<std::size_t> src_offsets(count), dest_offsets(count),
+                             src_lengths(count, buffer_size);
+    for (std::size_t i = 0; i < count; ++i)
+      src_offsets[i] = i * buffer_size;
+
+    double batch = MeasureBandwidth(count * buffer_size, [&]() {
+      MTBase64::EncodeBatchMem(encoded.data(), dest_offsets.data(),
+                               decoded.data(), src_offsets.data(),
+                               src_lengths.data(), count,
+                               MTBase64::kDefaultBase64);
+    });
+    double single = MeasureBandwidth(count * buffer_size, [&]() {
+      std::size_t encoded_length = MTBase64::GetEncodedLength(buffer_size,
+                                                              true);
+      for (std::size_t i = 0; i < count; ++i)
+        MTBase64::EncodeMem(encoded.data() + i * encoded_length,
+                            decoded.data() + src_offsets[i], buffer_size,
+                            MTBase64::kDefaultBase64);
+    });
+
+    std::cout << std::setw(5) << buffer_size << " B batch: encode "
+              << std::fixed << std::setprecision(1) << batch << " MiB/s, "
+              << "per buffer " << single << " MiB/s" << std::endl;
+  }
+}
@@ -80,7 +80,8 @@ int main(int argc, const char** argv) {
         std::async(std::launch::async, MTBase64::EncodeMem,
             encoded_buf + MTBase64::GetEncodedLength(offset, false),
             ifile_contents + offset, to_read,
-            std::ref(MTBase64::kDefaultBase64), true));
+            std::ref(MTBase64::kDefaultBase64), true,
+            MTBase64::StoreMode::kAuto));
 
     }
 
@@ -123,7 +124,8 @@ int main(int argc, const char** argv) {
         std::async(std::launch::async, MTBase64::DecodeMem,
           decoded_buf + d_offset,
           ifile_contents + offset, to_read,
-          std::ref(MTBase64::kDefaultBase64), true));
+          std::ref(MTBase64::kDefaultBase64), true,
+          MTBase64::StoreMode::kAuto));
 
     }
 
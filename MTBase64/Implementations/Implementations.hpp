@@ -0,0 +1,400 @@
+#ifndef MTBASE64_IMPLEMENTATIONS_HPP
+#define MTBASE64_IMPLEMENTATIONS_HPP
+
+#include "MTBase64.hpp"
+
+#include <cstring>
+
+/*Every kernel is compiled in its own translation unit with the instruction set
+flags it needs (see `build.ninja`), so nothing ISA specific may be defined in
+this header. The dispatcher in `MTBase64.cpp` is compiled without those flags
+and only calls a SIMD kernel after its `Supported` check passed. A SIMD kernel
+compiled without its flags is never supported and forwards to the SWAR one.
+
+`DecodeBase64` is also called with `dest == src` by `DecodeInPlace`. Each
+store of a decoder may therefore only overwrite characters it has already
+loaded. Decoding writes 3 bytes for every 4 characters, so stores of up to
+the size of the last load at `dest + d_bc` keep to that.
+
+The helpers defined below are `static`. Each kernel compiles its own copy
+with its own flags, so a copy built with AVX-512 instructions can never be
+the one the linker keeps for the other kernels. For the same reason the
+kernels with instruction set flags index `std::array` with `[]` instead of
+`at`, a weak function with a throwing path shared with `MTBase64.o`*/
+
+namespace MTBase64 {
+
+/*The decoders and transcoders do not throw, they return `nullptr` or one of
+these messages for the dispatcher to report with `kNotValidBase64`. That
+keeps invalid input as cheap as valid one for the `noexcept` API*/
+constexpr const char *kPaddedLengthError =
+  "Not valid base64 encoding length when padding is being used.";
+constexpr const char *kUnpaddedLengthError =
+  "Not valid base64 encoding length when padding is not being used.";
+constexpr const char *kCharacterError =
+  "Base64 encoded byte was not found in given table during decoding.";
+constexpr const char *kTranscodeCharacterError =
+  "Base64 encoded byte was not found in given table during transcoding.";
+
+/*Bytes skipped by `DecodeSkippingMem`, in the forms the kernels look them up*/
+struct IgnoredBytes
+{
+  std::array<uint8_t, 256> map;     /*0x80 for ignored bytes, 0 otherwise*/
+  std::array<uint8_t, 32> bitmap;   /*Bit `c & 7` of byte `c >> 3`*/
+
+  explicit IgnoredBytes(const std::string& bytes);
+};
+
+/*Character to character map used by `Transcode` for the characters of
+`from`. Padding is not part of it and is fixed up by the caller*/
+struct TranscodeMap
+{
+  const IndexTable& from;
+  const IndexTable& to;
+
+  std::array<uint8_t, 256> map;       /*Character of `to` for each of `from`*/
+  std::array<uint8_t, 256> invalid;   /*0x80 for bytes outside of `from`*/
+  std::array<uint8_t, 32> valid;      /*Bit `c & 7` of byte `c >> 3` is set
+                                        for the characters of `from`*/
+  uint16_t rows;                      /*Bit `c >> 4` is set for the rows of
+                                        16 bytes holding characters of `from`*/
+
+  TranscodeMap(const IndexTable& from_table, const IndexTable& to_table);
+};
+
+/*`pshufb` indices that move the kept bytes of 8 bytes to the front, indexed
+by the mask of kept bytes. Shared by the SIMD compaction of every kernel*/
+extern const std::array<uint64_t, 256> kCompactShuffles;
+
+struct IndexTableAccessor
+{
+  static const char *DecodeBase64(uint8_t *dest, const uint8_t *src,
+                                  std::size_t src_len, const IndexTable& table,
+                                  bool padding = true);
+  static void EncodeBase64(uint8_t *dest, const uint8_t *src,
+                           std::size_t src_len, const IndexTable& table,
+                           bool padding = true);
+  static std::size_t CompactBase64(uint8_t *dest, const uint8_t *src,
+                                   std::size_t src_len,
+                                   const IgnoredBytes& ignored);
+  static const char *TranscodeBase64(uint8_t *dest, const uint8_t *src,
+                                     std::size_t src_len,
+                                     const TranscodeMap& map);
+  static std::size_t ValidateBase64(const uint8_t *src, std::size_t src_len,
+                                    const IndexTable& table);
+  static std::size_t CountBase64(const uint8_t *src, std::size_t src_len,
+                                 const IgnoredBytes& ignored);
+  static void ClassifyBase64(uint64_t *valid, const uint8_t *src,
+                             std::size_t src_len, const IndexTable& table);
+  static const char *DecodeConstantTime(uint8_t *dest, const uint8_t *src,
+                                        std::size_t src_len,
+                                        const IndexTable& table,
+                                        bool padding = true);
+  static void EncodeBatchBase64(uint8_t *dest, const std::size_t *dest_offsets,
+                                const uint8_t *src,
+                                const std::size_t *src_offsets,
+                                const std::size_t *src_lengths,
+                                std::size_t count, const IndexTable& table,
+                                bool padding = true);
+  static void EncodeWrappedBase64(uint8_t *dest, const uint8_t *src,
+                                  std::size_t src_len, const IndexTable& table,
+                                  std::size_t line_length,
+                                  const uint8_t *separator,
+                                  std::size_t separator_len,
+                                  bool padding = true);
+};
+
+struct SWARIndexTableAccessor
+{
+  static const char *DecodeBase64(uint8_t *dest, const uint8_t *src,
+                                  std::size_t src_len, const IndexTable& table,
+                                  bool padding = true);
+  static void EncodeBase64(uint8_t *dest, const uint8_t *src,
+                           std::size_t src_len, const IndexTable& table,
+                           bool padding = true);
+  static std::size_t CompactBase64(uint8_t *dest, const uint8_t *src,
+                                   std::size_t src_len,
+                                   const IgnoredBytes& ignored);
+  static const char *TranscodeBase64(uint8_t *dest, const uint8_t *src,
+                                     std::size_t src_len,
+                                     const TranscodeMap& map);
+  static std::size_t ValidateBase64(const uint8_t *src, std::size_t src_len,
+                                    const IndexTable& table);
+  static std::size_t CountBase64(const uint8_t *src, std::size_t src_len,
+                                 const IgnoredBytes& ignored);
+  static void ClassifyBase64(uint64_t *valid, const uint8_t *src,
+                             std::size_t src_len, const IndexTable& table);
+  static const char *DecodeConstantTime(uint8_t *dest, const uint8_t *src,
+                                        std::size_t src_len,
+                                        const IndexTable& table,
+                                        bool padding = true);
+  static void EncodeBatchBase64(uint8_t *dest, const std::size_t *dest_offsets,
+                                const uint8_t *src,
+                                const std::size_t *src_offsets,
+                                const std::size_t *src_lengths,
+                                std::size_t count, const IndexTable& table,
+                                bool padding = true);
+  static void EncodeWrappedBase64(uint8_t *dest, const uint8_t *src,
+                                  std::size_t src_len, const IndexTable& table,
+                                  std::size_t line_length,
+                                  const uint8_t *separator,
+                                  std::size_t separator_len,
+                                  bool padding = true);
+};
+
+struct AVX2IndexTableAccessor
+{
+  static bool Supported();
+
+  static const char *DecodeBase64(uint8_t *dest, const uint8_t *src,
+                                  std::size_t src_len, const IndexTable& table,
+                                  bool padding = true);
+  static void EncodeBase64(uint8_t *dest, const uint8_t *src,
+                           std::size_t src_len, const IndexTable& table,
+                           bool padding = true);
+  static std::size_t CompactBase64(uint8_t *dest, const uint8_t *src,
+                                   std::size_t src_len,
+                                   const IgnoredBytes& ignored);
+  static const char *TranscodeBase64(uint8_t *dest, const uint8_t *src,
+                                     std::size_t src_len,
+                                     const TranscodeMap& map);
+  static std::size_t ValidateBase64(const uint8_t *src, std::size_t src_len,
+                                    const IndexTable& table);
+  static std::size_t CountBase64(const uint8_t *src, std::size_t src_len,
+                                 const IgnoredBytes& ignored);
+  static void ClassifyBase64(uint64_t *valid, const uint8_t *src,
+                             std::size_t src_len, const IndexTable& table);
+  static const char *DecodeConstantTime(uint8_t *dest, const uint8_t *src,
+                                        std::size_t src_len,
+                                        const IndexTable& table,
+                                        bool padding = true);
+
+  static void EncodeBatchBase64(uint8_t *dest, const std::size_t *dest_offsets,
+                                const uint8_t *src,
+                                const std::size_t *src_offsets,
+                                const std::size_t *src_lengths,
+                                std::size_t count, const IndexTable& table,
+                                bool padding = true);
+  static void EncodeWrappedBase64(uint8_t *dest, const uint8_t *src,
+                                  std::size_t src_len, const IndexTable& table,
+                                  std::size_t line_length,
+                                  const uint8_t *separator,
+                                  std::size_t separator_len,
+                                  bool padding = true);
+private:
+  /*Shared by `DecodeBase64` and `DecodeConstantTime`, only defined in the
+  translation unit of the kernel*/
+  template <bool kConstantTime>
+  static const char *Decode(uint8_t *dest, const uint8_t *src,
+                            std::size_t src_len, const IndexTable& table,
+                            bool padding);
+};
+
+struct VBMIIndexTableAccessor
+{
+  static bool Supported();
+
+  static const char *DecodeBase64(uint8_t *dest, const uint8_t *src,
+                                  std::size_t src_len, const IndexTable& table,
+                                  bool padding = true);
+  static void EncodeBase64(uint8_t *dest, const uint8_t *src,
+                           std::size_t src_len, const IndexTable& table,
+                           bool padding = true);
+  static std::size_t CompactBase64(uint8_t *dest, const uint8_t *src,
+                                   std::size_t src_len,
+                                   const IgnoredBytes& ignored);
+  static const char *TranscodeBase64(uint8_t *dest, const uint8_t *src,
+                                     std::size_t src_len,
+                                     const TranscodeMap& map);
+  static std::size_t ValidateBase64(const uint8_t *src, std::size_t src_len,
+                                    const IndexTable& table);
+  static std::size_t CountBase64(const uint8_t *src, std::size_t src_len,
+                                 const IgnoredBytes& ignored);
+  static void ClassifyBase64(uint64_t *valid, const uint8_t *src,
+                             std::size_t src_len, const IndexTable& table);
+  static const char *DecodeConstantTime(uint8_t *dest, const uint8_t *src,
+                                        std::size_t src_len,
+                                        const IndexTable& table,
+                                        bool padding = true);
+
+  static void EncodeBatchBase64(uint8_t *dest, const std::size_t *dest_offsets,
+                                const uint8_t *src,
+                                const std::size_t *src_offsets,
+                                const std::size_t *src_lengths,
+                                std::size_t count, const IndexTable& table,
+                                bool padding = true);
+  static void EncodeWrappedBase64(uint8_t *dest, const uint8_t *src,
+                                  std::size_t src_len, const IndexTable& table,
+                                  std::size_t line_length,
+                                  const uint8_t *separator,
+                                  std::size_t separator_len,
+                                  bool padding = true);
+private:
+  /*Shared by `DecodeBase64` and `DecodeConstantTime`, only defined in the
+  translation unit of the kernel*/
+  template <bool kConstantTime>
+  static const char *Decode(uint8_t *dest, const uint8_t *src,
+                            std::size_t src_len, const IndexTable& table,
+                            bool padding);
+};
+
+/*Copies the `len` bytes at `src`, 1 to 12 of them, to the start of the 16
+bytes at `chunk` and zeroes the rest. Only fixed size loads inside of `src`
+and two 8 byte stores are used, which the 8 and 4 byte loads of a chunk are
+forwarded from*/
+static inline void StagePartialChunk(uint8_t *chunk, const uint8_t *src,
+                                     std::size_t len) {
+  uint64_t lo = 0, hi = 0;
+  uint32_t a, b;
+
+  if (len >= 8) {
+    std::memcpy(&lo, src, 8);
+    std::memcpy(&b, src + len - 4, 4);
+    hi = static_cast<uint64_t>(b) >> (8 * (12 - len));
+  } else if (len >= 4) {
+    std::memcpy(&a, src, 4);
+    std::memcpy(&b, src + len - 4, 4);
+    lo = a | ((static_cast<uint64_t>(b) >> (8 * (8 - len))) << 32);
+  } else {
+    lo = src[0] | (static_cast<uint64_t>(src[len / 2]) << (8 * (len / 2))) |
+         (static_cast<uint64_t>(src[len - 1]) << (8 * (len - 1)));
+  }
+
+  std::memcpy(chunk, &lo, 8);
+  std::memcpy(chunk + 8, &hi, 8);
+}
+
+/*Copies the first `len` bytes, 1 to 16 of them, of `src` to `dest` with two
+overlapping fixed size copies*/
+static inline void CopyPartial(uint8_t *dest, const uint8_t *src,
+                               std::size_t len) {
+  if (len >= 8) {
+    std::memcpy(dest, src, 8);
+    std::memcpy(dest + len - 8, src + len - 8, 8);
+  } else if (len >= 4) {
+    std::memcpy(dest, src, 4);
+    std::memcpy(dest + len - 4, src + len - 4, 4);
+  } else if (len >= 2) {
+    std::memcpy(dest, src, 2);
+    std::memcpy(dest + len - 2, src + len - 2, 2);
+  } else {
+    dest[0] = src[0];
+  }
+}
+
+/*Walks the buffers of `EncodeBatchBase64` in chunks of 12 bytes that a SIMD
+kernel encodes `kLanes` at a time with `encode_lanes(srcs, dests, lanes)`.
+Chunks are taken from any buffer, so short buffers fill the lanes as well as
+long ones. The 1 to 11 bytes after the last whole chunk of a buffer take a
+lane of their own: they are staged into a zeroed chunk and their characters
+are copied out of a staged output, which keeps the 16 byte stores of the
+lane inside of the buffer*/
+template <int kLanes, typename EncodeLanes>
+static void EncodeBatchChunks(uint8_t *dest, const std::size_t *dest_offsets,
+                              const uint8_t *src,
+                              const std::size_t *src_offsets,
+                              const std::size_t *src_lengths,
+                              std::size_t count, const IndexTable& table,
+                              bool padding, EncodeLanes encode_lanes) {
+  const uint8_t *lane_src[kLanes];
+  uint8_t *lane_dest[kLanes];
+  int lanes = 0;
+
+  alignas(16) uint8_t staged_src[kLanes][16];
+  alignas(16) uint8_t staged_dest[kLanes][16];
+  uint8_t *staged_out[kLanes];
+  std::size_t staged_len[kLanes];
+  int staged = 0;
+  const uint8_t padding_byte = table.GetPadding();
+
+  auto flush = [&]() {
+    encode_lanes(lane_src, lane_dest, lanes);
+
+    for (int k = 0; k < staged; ++k) {
+      const std::size_t len = staged_len[k];
+      const std::size_t chars = (len * 4 + 2) / 3;
+
+      CopyPartial(staged_out[k], staged_dest[k], chars);
+      if (padding && len % 3 != 0) {
+        staged_out[k][chars] = padding_byte;
+        if (len % 3 == 1)
+          staged_out[k][chars + 1] = padding_byte;
+      }
+    }
+    lanes = 0;
+    staged = 0;
+  };
+
+  for (std::size_t i = 0; i < count; ++i) {
+    const uint8_t *in = src + src_offsets[i];
+    uint8_t *out = dest + dest_offsets[i];
+    const std::size_t len = src_lengths[i];
+
+    std::size_t d_bc = 0;
+    for (; len - d_bc >= 12; d_bc += 12) {
+      lane_src[lanes] = in + d_bc;
+      lane_dest[lanes] = out + d_bc / 3 * 4;
+      if (++lanes == kLanes)
+        flush();
+    }
+
+    if (d_bc < len) {
+      StagePartialChunk(staged_src[staged], in + d_bc, len - d_bc);
+      staged_out[staged] = out + d_bc / 3 * 4;
+      staged_len[staged] = len - d_bc;
+
+      lane_src[lanes] = staged_src[staged];
+      lane_dest[lanes] = staged_dest[staged];
+      ++staged;
+      if (++lanes == kLanes)
+        flush();
+    }
+  }
+
+  if (lanes > 0)
+    flush();
+}
+
+/*Encodes `src` into lines of `line_length` characters for
+`EncodeWrappedBase64`, writing the separator after every line but the last.
+`encode_line(dest, src)` encodes the `line_length / 4 * 3` bytes of a whole
+line straight into `dest` and may read up to `overread` bytes past them.
+Lines closer than that to the end of `src` and the last line, which is the
+only one that can get padding, are encoded by `encode_tail(dest, src, len,
+padding)`. Separators of up to 16 bytes are written with fixed size copies*/
+template <typename EncodeLine, typename EncodeTail>
+static void EncodeLines(uint8_t *dest, const uint8_t *src, std::size_t src_len,
+                        std::size_t line_length, const uint8_t *separator,
+                        std::size_t separator_len, bool padding,
+                        std::size_t overread, EncodeLine encode_line,
+                        EncodeTail encode_tail) {
+  const std::size_t d_line = line_length / 4 * 3;
+  std::size_t d_bc = 0, e_bc = 0;
+
+  auto write_separator = [&](uint8_t *out) {
+    if (separator_len > 16)
+      std::memcpy(out, separator, separator_len);
+    else if (separator_len > 0)
+      CopyPartial(out, separator, separator_len);
+  };
+
+  while (src_len - d_bc > d_line + overread) {
+    encode_line(dest + e_bc, src + d_bc);
+    write_separator(dest + e_bc + line_length);
+    d_bc += d_line;
+    e_bc += line_length + separator_len;
+  }
+
+  while (src_len - d_bc > d_line) {
+    encode_tail(dest + e_bc, src + d_bc, d_line, false);
+    write_separator(dest + e_bc + line_length);
+    d_bc += d_line;
+    e_bc += line_length + separator_len;
+  }
+
+  encode_tail(dest + e_bc, src + d_bc, src_len - d_bc, padding);
+}
+
+} /* MTBase64 */
+
+#endif /* end of include guard: MTBASE64_IMPLEMENTATIONS_HPP */
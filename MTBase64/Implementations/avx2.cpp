@@ -0,0 +1,716 @@
+#include "Implementations/Implementations.hpp"
+
+#include <cstring>
+
+/* Special thanks to:
+ * http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html
+ * http://0x80.pl/notesen/2016-01-17-sse-base64-decoding.html
+ */
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+
+bool MTBase64::AVX2IndexTableAccessor::Supported() {
+    return __builtin_cpu_supports("avx2");
+}
+
+/*Merges the four 6 bit values of each 32 bit lane into 24 bits and puts
+them in memory order using `pack`*/
+static inline __m256i MergeSextets(__m256i sextets, __m256i pack) {
+    const __m256i merged = _mm256_maddubs_epi16(
+        sextets, _mm256_set1_epi32(0x01400140));
+    const __m256i out = _mm256_madd_epi16(merged,
+                                          _mm256_set1_epi32(0x00011000));
+    return _mm256_shuffle_epi8(out, pack);
+}
+
+/*A bitmap of 256 bits with bit `c & 7` of byte `c >> 3` set for the bytes
+`c` it holds. Each 16 byte half is broadcast to both 128 bit lanes*/
+struct ByteBitmap {
+    __m256i lo, hi;
+};
+
+static inline ByteBitmap LoadBitmap(const uint8_t *bitmap) {
+    return {
+        _mm256_broadcastsi128_si256(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(bitmap))),
+        _mm256_broadcastsi128_si256(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(bitmap + 16)))};
+}
+
+/*Sets the bytes of `in` that are in `bitmap` to 0xFF and all others to 0.
+The byte of the bitmap is looked up with two `pshufb` on `c >> 3`, the top
+bit of `c` picks the half, and the bit with one `pshufb` on `c & 7`*/
+static inline __m256i InBitmap(__m256i in, const ByteBitmap& bitmap) {
+    const __m256i bits = _mm256_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+
+    const __m256i row = _mm256_and_si256(_mm256_srli_epi16(in, 3),
+                                         _mm256_set1_epi8(0x0F));
+    const __m256i byte = _mm256_blendv_epi8(
+        _mm256_shuffle_epi8(bitmap.lo, row),
+        _mm256_shuffle_epi8(bitmap.hi, row), in);
+    const __m256i bit = _mm256_shuffle_epi8(
+        bits, _mm256_and_si256(in, _mm256_set1_epi8(0x07)));
+
+    return _mm256_cmpeq_epi8(_mm256_and_si256(byte, bit), bit);
+}
+
+/*Encodes the first 12 bytes of each 128 bit lane to 16 characters. Tables
+starting with `A-Za-z0-9` map indices to characters with the shift lookup,
+all other tables blend the four rows of 16 characters*/
+static inline __m256i EncodeLanes(__m256i in, bool rfc_prefix,
+                                  __m256i shift_lut, const __m256i rows[4]) {
+    /* Places the 3 bytes of each 32 bit lane as [b1, b0, b2, b1] so that
+     * every 16 bit half holds the bits of two neighbouring indices
+     */
+    const __m256i reshuffle = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    in = _mm256_shuffle_epi8(in, reshuffle);
+
+    /* Moves the four 6 bit indices of each lane to separate bytes */
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i out;
+    if (rfc_prefix) {
+        /* 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12 */
+        __m256i reduced = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        reduced = _mm256_or_si256(
+            reduced, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+
+        out = _mm256_add_epi8(_mm256_shuffle_epi8(shift_lut, reduced),
+                              indices);
+    } else {
+        /* The lower nibble selects the character inside of each row,
+         * bits 4 and 5 are shifted to the top of the byte for blending
+         */
+        const __m256i lo = _mm256_and_si256(indices, _mm256_set1_epi8(0x0F));
+        const __m256i bit4 = _mm256_slli_epi16(indices, 3);
+        const __m256i bit5 = _mm256_slli_epi16(indices, 2);
+
+        const __m256i low_rows = _mm256_blendv_epi8(
+            _mm256_shuffle_epi8(rows[0], lo), _mm256_shuffle_epi8(rows[1], lo),
+            bit4);
+        const __m256i high_rows = _mm256_blendv_epi8(
+            _mm256_shuffle_epi8(rows[2], lo), _mm256_shuffle_epi8(rows[3], lo),
+            bit4);
+        out = _mm256_blendv_epi8(low_rows, high_rows, bit5);
+    }
+
+    return out;
+}
+
+/*Decodes 32 characters to 24 bytes per iteration. Tables starting with
+`A-Za-z0-9` are translated with nibble lookups, other tables with the ranges
+of their decode plan and any remaining table by gathering from `d0`..`d3`.
+Invalid characters are collected in an error mask that is checked once
+after the whole buffer has been decoded. The last 16-47 characters
+(including the padding) are passed on to the SWAR implementation.
+
+In constant time the remaining tables are translated with `pshufb` lookups
+into all 16 rows of `d_perm` instead of the gathers, so no memory access
+depends on the input, and the last characters are passed on to the constant
+time table implementation*/
+template <bool kConstantTime>
+const char *MTBase64::AVX2IndexTableAccessor::Decode(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    const bool rfc_prefix = table.rfc_prefix_ && table.nibble_check_;
+
+    if (padding && !MTBase64::ValidPaddedEncodedLength(src_len))
+        return kPaddedLengthError;
+
+    if (!padding && !MTBase64::ValidUnpaddedEncodedLength(src_len))
+        return kUnpaddedLengthError;
+
+    const __m256i check_lo = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.d_lo.data())));
+    const __m256i check_hi = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.d_hi.data())));
+
+    /* Distance from the characters `0-9`, `A-Z` and `a-z` to their index,
+     * selected by the upper nibble. The last two characters of the table
+     * are blended in separately
+     */
+    const __m256i delta = _mm256_setr_epi8(
+        0, 0, 0, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i char62 = _mm256_set1_epi8(table.e[62]);
+    const __m256i char63 = _mm256_set1_epi8(table.e[63]);
+
+    __m256i range_start[8], range_last[8], range_index[8];
+    const uint8_t ranges = table.d_plan_size_;
+    for (uint8_t r = 0; r < ranges; ++r) {
+        range_start[r] = _mm256_set1_epi8(table.d_plan[r].start);
+        range_last[r]  = _mm256_set1_epi8(table.d_plan[r].length - 1);
+        range_index[r] = _mm256_set1_epi8(table.d_plan[r].index);
+    }
+
+    /* Reverses the byte order of the 3 bytes that are left in each 32 bit
+     * lane and moves them to the lowest 24 bytes of the register
+     */
+    const __m256i pack = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    /* Same without reversing, the `d0`..`d3` entries are already stored in
+     * memory order
+     */
+    const __m256i pack_gathered = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+    const int *d0 = reinterpret_cast<const int*>(table.d0.data());
+    const int *d1 = reinterpret_cast<const int*>(table.d1.data());
+    const int *d2 = reinterpret_cast<const int*>(table.d2.data());
+    const int *d3 = reinterpret_cast<const int*>(table.d3.data());
+
+    __m256i perm_rows[16];
+    for (int row = 0; row < 16; ++row)
+        perm_rows[row] = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(table.d_perm.data() + 16 * row)));
+
+    __m256i error = _mm256_setzero_si256();
+    std::size_t e_bc = 0, d_bc = 0;
+
+    /* 32 bytes are stored for every 24 decoded bytes. At least 16 more
+     * characters must remain after the block so the store stays inside of
+     * the decoded length and the padding stays outside of the block
+     */
+    while (src_len - e_bc >= 48) {
+        const __m256i in = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + e_bc));
+
+        __m256i out;
+        if (rfc_prefix) {
+            const __m256i hi = _mm256_and_si256(_mm256_srli_epi32(in, 4),
+                                                _mm256_set1_epi8(0x0F));
+            const __m256i lo = _mm256_and_si256(in, _mm256_set1_epi8(0x0F));
+
+            error = _mm256_or_si256(error, _mm256_and_si256(
+                _mm256_shuffle_epi8(check_lo, lo),
+                _mm256_shuffle_epi8(check_hi, hi)));
+
+            __m256i sextets = _mm256_add_epi8(in, _mm256_shuffle_epi8(delta, hi));
+            sextets = _mm256_blendv_epi8(sextets, _mm256_set1_epi8(62),
+                                         _mm256_cmpeq_epi8(in, char62));
+            sextets = _mm256_blendv_epi8(sextets, _mm256_set1_epi8(63),
+                                         _mm256_cmpeq_epi8(in, char63));
+
+            out = MergeSextets(sextets, pack);
+        } else if (ranges > 0) {
+            /* The ranges don't overlap, so every valid character matches
+             * exactly one of them and the results can be OR-ed together
+             */
+            __m256i valid = _mm256_setzero_si256();
+            __m256i sextets = _mm256_setzero_si256();
+            for (uint8_t r = 0; r < ranges; ++r) {
+                const __m256i offset = _mm256_sub_epi8(in, range_start[r]);
+                const __m256i inside = _mm256_cmpeq_epi8(
+                    _mm256_min_epu8(offset, range_last[r]), offset);
+
+                valid = _mm256_or_si256(valid, inside);
+                sextets = _mm256_or_si256(sextets, _mm256_and_si256(
+                    inside, _mm256_add_epi8(offset, range_index[r])));
+            }
+
+            error = _mm256_or_si256(error, _mm256_cmpeq_epi8(
+                valid, _mm256_setzero_si256()));
+
+            out = MergeSextets(sextets, pack);
+        } else if (kConstantTime) {
+            /* Each row only answers for the characters of its upper nibble,
+             * characters outside of the table keep the top bit of `d_perm`
+             */
+            const __m256i hi = _mm256_and_si256(in, _mm256_set1_epi8(-16));
+            const __m256i lo = _mm256_and_si256(in, _mm256_set1_epi8(0x0F));
+
+            __m256i sextets = _mm256_setzero_si256();
+            for (int row = 0; row < 16; ++row)
+                sextets = _mm256_or_si256(sextets, _mm256_and_si256(
+                    _mm256_cmpeq_epi8(hi, _mm256_set1_epi8(
+                        static_cast<char>(row << 4))),
+                    _mm256_shuffle_epi8(perm_rows[row], lo)));
+
+            error = _mm256_or_si256(error, _mm256_and_si256(
+                sextets, _mm256_set1_epi8(-128)));
+
+            out = MergeSextets(sextets, pack);
+        } else {
+            /* Every 32 bit lane holds one quad, each of its characters is
+             * gathered from its own table like in the scalar implementation
+             */
+            __m256i quads = _mm256_i32gather_epi32(
+                d0, _mm256_and_si256(in, byte_mask), 4);
+            quads = _mm256_or_si256(quads, _mm256_i32gather_epi32(
+                d1, _mm256_and_si256(_mm256_srli_epi32(in, 8), byte_mask), 4));
+            quads = _mm256_or_si256(quads, _mm256_i32gather_epi32(
+                d2, _mm256_and_si256(_mm256_srli_epi32(in, 16), byte_mask), 4));
+            quads = _mm256_or_si256(quads, _mm256_i32gather_epi32(
+                d3, _mm256_srli_epi32(in, 24), 4));
+
+            error = _mm256_or_si256(error, _mm256_cmpgt_epi32(
+                quads, _mm256_set1_epi32(MTBASE64__BADCHAR - 1)));
+
+            out = _mm256_shuffle_epi8(quads, pack_gathered);
+        }
+
+        out = _mm256_permutevar8x32_epi32(out, lanes);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + d_bc), out);
+        e_bc += 32;
+        d_bc += 24;
+    }
+
+    const char *tail = kConstantTime ?
+        MTBase64::IndexTableAccessor::DecodeConstantTime(
+            dest + d_bc, src + e_bc, src_len - e_bc, table, padding) :
+        MTBase64::SWARIndexTableAccessor::DecodeBase64(
+            dest + d_bc, src + e_bc, src_len - e_bc, table, padding);
+    if (tail != nullptr)
+        return tail;
+
+    return (!_mm256_testz_si256(error, error)) ? kCharacterError : nullptr;
+}
+
+const char *MTBase64::AVX2IndexTableAccessor::DecodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    return Decode<false>(dest, src, src_len, table, padding);
+}
+
+/*Tables starting with `A-Za-z0-9` and the ones with a decode plan are
+already decoded with arithmetic on registers only*/
+const char *MTBase64::AVX2IndexTableAccessor::DecodeConstantTime(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    return Decode<true>(dest, src, src_len, table, padding);
+}
+
+/*Encodes 24 input bytes to 32 characters per iteration. Tables starting
+with `A-Za-z0-9` map indices to characters with a shift lookup, all other
+tables blend four 16 character lookups addressed by the lower nibble. The
+last chunk shorter than 28 bytes (including the padding) is passed on to
+the SWAR implementation*/
+void MTBase64::AVX2IndexTableAccessor::EncodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    const __m256i shift_lut = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.e_shift.data())));
+    __m256i rows[4];
+    for (int row = 0; row < 4; ++row)
+        rows[row] = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(table.e_rows[row].data()));
+    const bool rfc_prefix = table.rfc_prefix_;
+
+    std::size_t d_bc = 0, e_bc = 0;
+
+    /* The upper 16 byte load starts at offset 12, so 4 more bytes than the
+     * 24 being encoded must be readable. This also guarantees a non empty
+     * remainder for the SWAR implementation
+     */
+    while (src_len - d_bc >= 28) {
+        const __m256i in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + d_bc))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + d_bc + 12)),
+            1);
+        const __m256i out = EncodeLanes(in, rfc_prefix, shift_lut, rows);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + e_bc), out);
+        d_bc += 24;
+        e_bc += 32;
+    }
+
+    MTBase64::SWARIndexTableAccessor::EncodeBase64(dest + e_bc, src + d_bc,
+                                                   src_len - d_bc, table,
+                                                   padding);
+}
+
+/*Encodes whole lines 24 bytes at a time like `EncodeBase64`. A line that
+isn't a multiple of 24 bytes ends with the 24 bytes before its end encoded
+once more, so every line of 32 characters or more is encoded in registers.
+The upper load reads up to 4 bytes past a line. Shorter lines are encoded
+by the SWAR implementation*/
+void MTBase64::AVX2IndexTableAccessor::EncodeWrappedBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, std::size_t line_length,
+    const uint8_t *separator, std::size_t separator_len, bool padding) {
+
+    const __m256i shift_lut = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.e_shift.data())));
+    __m256i rows[4];
+    for (int row = 0; row < 4; ++row)
+        rows[row] = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(table.e_rows[row].data()));
+    const bool rfc_prefix = table.rfc_prefix_;
+    const std::size_t d_line = line_length / 4 * 3;
+
+    auto encode_block = [&](uint8_t *out, const uint8_t *in) {
+        const __m256i block = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12)), 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                            EncodeLanes(block, rfc_prefix, shift_lut, rows));
+    };
+
+    auto encode_line = [&](uint8_t *out, const uint8_t *in) {
+        if (d_line < 24) {
+            MTBase64::SWARIndexTableAccessor::EncodeBase64(out, in, d_line,
+                                                           table, false);
+            return;
+        }
+
+        std::size_t d_bc = 0;
+        for (; d_line - d_bc >= 24; d_bc += 24)
+            encode_block(out + d_bc / 3 * 4, in + d_bc);
+        if (d_bc < d_line)
+            encode_block(out + line_length - 32, in + d_line - 24);
+    };
+
+    MTBase64::EncodeLines(dest, src, src_len, line_length, separator,
+                          separator_len, padding, 4, encode_line,
+                          [&](uint8_t *out, const uint8_t *in,
+                              std::size_t len, bool pad) {
+                              MTBase64::AVX2IndexTableAccessor::EncodeBase64(
+                                  out, in, len, table, pad);
+                          });
+}
+
+/*Compacts 32 bytes per iteration. Ignored bytes are looked up in their
+bitmap with `InBitmap`. Blocks without ignored bytes are stored as they
+are, the others are compacted 8 bytes at a time with `kCompactShuffles`.
+The last 0-31 bytes are passed on to the SWAR implementation*/
+std::size_t MTBase64::AVX2IndexTableAccessor::CompactBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    const ByteBitmap bitmap = LoadBitmap(ignored.bitmap.data());
+
+    std::size_t e_bc = 0, kept = 0;
+
+    /* The output never gets ahead of the input, so every store stays inside
+     * of the `src_len` bytes of `dest`
+     */
+    while (src_len - e_bc >= 32) {
+        const __m256i in = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + e_bc));
+        const uint32_t keep = ~static_cast<uint32_t>(
+            _mm256_movemask_epi8(InBitmap(in, bitmap)));
+        if (keep == 0xFFFFFFFF) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + kept), in);
+            kept += 32;
+        } else {
+            for (int group = 0; group < 4; ++group) {
+                const uint8_t mask = static_cast<uint8_t>(keep >> (8 * group));
+                const __m128i shuffled = _mm_shuffle_epi8(
+                    _mm_loadl_epi64(
+                        reinterpret_cast<const __m128i*>(src + e_bc + 8 * group)),
+                    _mm_cvtsi64_si128(static_cast<long long>(
+                        MTBase64::kCompactShuffles[mask])));
+
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + kept),
+                                 shuffled);
+                kept += __builtin_popcount(mask);
+            }
+        }
+
+        e_bc += 32;
+    }
+
+    return kept + MTBase64::SWARIndexTableAccessor::CompactBase64(
+        dest + kept, src + e_bc, src_len - e_bc, ignored);
+}
+
+/*Maps 32 characters per iteration with `pshufb` lookups into the rows of 16
+bytes of `map` that hold characters of `from`, selected by the upper nibble.
+The characters are validated against the `valid` bitmap like in the
+compaction. The last 0-31 characters are passed on to the SWAR
+implementation*/
+const char *MTBase64::AVX2IndexTableAccessor::TranscodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::TranscodeMap& map) {
+
+    const ByteBitmap valid = LoadBitmap(map.valid.data());
+
+    __m256i rows[16], row_nibbles[16];
+    int row_count = 0;
+    for (int row = 0; row < 16; ++row) {
+        if ((map.rows & (1 << row)) == 0)
+            continue;
+
+        rows[row_count] = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(map.map.data() + 16 * row)));
+        row_nibbles[row_count] = _mm256_set1_epi8(static_cast<char>(row << 4));
+        ++row_count;
+    }
+
+    __m256i checked = _mm256_set1_epi8(-1);
+    std::size_t e_bc = 0;
+
+    while (src_len - e_bc >= 32) {
+        const __m256i in = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + e_bc));
+        const __m256i hi = _mm256_and_si256(in, _mm256_set1_epi8(-16));
+        const __m256i lo = _mm256_and_si256(in, _mm256_set1_epi8(0x0F));
+
+        checked = _mm256_and_si256(checked, InBitmap(in, valid));
+
+        __m256i out = _mm256_setzero_si256();
+        for (int r = 0; r < row_count; ++r)
+            out = _mm256_or_si256(out, _mm256_and_si256(
+                _mm256_cmpeq_epi8(hi, row_nibbles[r]),
+                _mm256_shuffle_epi8(rows[r], lo)));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + e_bc), out);
+        e_bc += 32;
+    }
+
+    const char *tail = MTBase64::SWARIndexTableAccessor::TranscodeBase64(
+        dest + e_bc, src + e_bc, src_len - e_bc, map);
+    if (tail != nullptr)
+        return tail;
+
+    if (!_mm256_testc_si256(checked, _mm256_set1_epi8(-1)))
+        return kTranscodeCharacterError;
+
+    return nullptr;
+}
+
+/*Checks 32 characters per iteration against the `d_valid` bitmap with
+`InBitmap`. The first invalid character is found in the mask of the block
+holding it. The last 0-31 characters are passed on to the SWAR
+implementation*/
+std::size_t MTBase64::AVX2IndexTableAccessor::ValidateBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    const ByteBitmap valid = LoadBitmap(table.d_valid.data());
+
+    std::size_t e_bc = 0;
+
+    while (src_len - e_bc >= 32) {
+        const __m256i in = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + e_bc));
+        const uint32_t invalid = ~static_cast<uint32_t>(
+            _mm256_movemask_epi8(InBitmap(in, valid)));
+
+        if (invalid != 0)
+            return e_bc + __builtin_ctz(invalid);
+
+        e_bc += 32;
+    }
+
+    return e_bc + MTBase64::SWARIndexTableAccessor::ValidateBase64(
+        src + e_bc, src_len - e_bc, table);
+}
+
+/*Classifies 32 bytes per iteration like the compaction and counts the ones
+that are not ignored with `popcnt` on the byte mask. The last 0-31 bytes
+are passed on to the SWAR implementation*/
+std::size_t MTBase64::AVX2IndexTableAccessor::CountBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    const ByteBitmap bitmap = LoadBitmap(ignored.bitmap.data());
+
+    std::size_t e_bc = 0, skipped = 0;
+
+    while (src_len - e_bc >= 32) {
+        const __m256i in = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + e_bc));
+
+        skipped += __builtin_popcount(static_cast<uint32_t>(
+            _mm256_movemask_epi8(InBitmap(in, bitmap))));
+        e_bc += 32;
+    }
+
+    return e_bc - skipped + MTBase64::SWARIndexTableAccessor::CountBase64(
+        src + e_bc, src_len - e_bc, ignored);
+}
+
+/*Classifies 64 bytes per iteration with the `d_valid` lookups of the
+validation, the byte masks of both halves make up one word. The last 0-63
+bytes are passed on to the table implementation*/
+void MTBase64::AVX2IndexTableAccessor::ClassifyBase64(
+    uint64_t *valid, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    const ByteBitmap bitmap = LoadBitmap(table.d_valid.data());
+
+    auto classify = [&](const uint8_t *block) {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(InBitmap(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)),
+            bitmap)));
+    };
+
+    std::size_t e_bc = 0;
+
+    while (src_len - e_bc >= 64) {
+        const uint64_t upper = classify(src + e_bc + 32);
+        valid[e_bc / 64] = classify(src + e_bc) | upper << 32;
+        e_bc += 64;
+    }
+
+    MTBase64::IndexTableAccessor::ClassifyBase64(valid + e_bc / 64, src + e_bc,
+                                                 src_len - e_bc, table);
+}
+
+/*Encodes four chunks of 12 bytes per iteration in two registers, one in
+each 128 bit lane. Each chunk is loaded with an 8 and a 4 byte load, so
+nothing past it is read*/
+void MTBase64::AVX2IndexTableAccessor::EncodeBatchBase64(
+    uint8_t *dest, const std::size_t *dest_offsets, const uint8_t *src,
+    const std::size_t *src_offsets, const std::size_t *src_lengths,
+    std::size_t count, const MTBase64::IndexTable& table, bool padding) {
+
+    const __m256i shift_lut = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.e_shift.data())));
+    __m256i rows[4];
+    for (int row = 0; row < 4; ++row)
+        rows[row] = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(table.e_rows[row].data()));
+    const bool rfc_prefix = table.rfc_prefix_;
+
+    auto load_chunk = [](const uint8_t *chunk) {
+        int32_t last;
+        std::memcpy(&last, chunk + 8, 4);
+        return _mm_insert_epi32(_mm_loadl_epi64(
+            reinterpret_cast<const __m128i*>(chunk)), last, 2);
+    };
+
+    /* Lanes without a chunk repeat the first one and are not stored */
+    auto encode_lanes = [&](const uint8_t *const *srcs, uint8_t *const *dests,
+                            int lanes) {
+        const __m256i in0 = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(load_chunk(srcs[0])),
+            load_chunk(srcs[lanes > 1 ? 1 : 0]), 1);
+        const __m256i in1 = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(load_chunk(srcs[lanes > 2 ? 2 : 0])),
+            load_chunk(srcs[lanes > 3 ? 3 : 0]), 1);
+        const __m256i out0 = EncodeLanes(in0, rfc_prefix, shift_lut, rows);
+        const __m256i out1 = EncodeLanes(in1, rfc_prefix, shift_lut, rows);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dests[0]),
+                         _mm256_castsi256_si128(out0));
+        if (lanes > 1)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dests[1]),
+                             _mm256_extracti128_si256(out0, 1));
+        if (lanes > 2)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dests[2]),
+                             _mm256_castsi256_si128(out1));
+        if (lanes > 3)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dests[3]),
+                             _mm256_extracti128_si256(out1, 1));
+    };
+
+    MTBase64::EncodeBatchChunks<4>(dest, dest_offsets, src, src_offsets,
+                                   src_lengths, count, table, padding,
+                                   encode_lanes);
+}
+
+#else
+
+/*Built without the instruction set, the dispatcher never picks this kernel*/
+bool MTBase64::AVX2IndexTableAccessor::Supported() {
+    return false;
+}
+
+const char *MTBase64::AVX2IndexTableAccessor::DecodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    return MTBase64::SWARIndexTableAccessor::DecodeBase64(dest, src, src_len,
+                                                          table, padding);
+}
+
+void MTBase64::AVX2IndexTableAccessor::EncodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    MTBase64::SWARIndexTableAccessor::EncodeBase64(dest, src, src_len, table,
+                                                   padding);
+}
+
+std::size_t MTBase64::AVX2IndexTableAccessor::CompactBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    return MTBase64::SWARIndexTableAccessor::CompactBase64(dest, src, src_len,
+                                                           ignored);
+}
+
+const char *MTBase64::AVX2IndexTableAccessor::TranscodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::TranscodeMap& map) {
+
+    return MTBase64::SWARIndexTableAccessor::TranscodeBase64(dest, src, src_len,
+                                                             map);
+}
+
+std::size_t MTBase64::AVX2IndexTableAccessor::ValidateBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    return MTBase64::SWARIndexTableAccessor::ValidateBase64(src, src_len,
+                                                            table);
+}
+
+std::size_t MTBase64::AVX2IndexTableAccessor::CountBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    return MTBase64::SWARIndexTableAccessor::CountBase64(src, src_len, ignored);
+}
+
+void MTBase64::AVX2IndexTableAccessor::ClassifyBase64(
+    uint64_t *valid, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    MTBase64::SWARIndexTableAccessor::ClassifyBase64(valid, src, src_len,
+                                                     table);
+}
+
+const char *MTBase64::AVX2IndexTableAccessor::DecodeConstantTime(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    return MTBase64::SWARIndexTableAccessor::DecodeConstantTime(
+        dest, src, src_len, table, padding);
+}
+
+void MTBase64::AVX2IndexTableAccessor::EncodeBatchBase64(
+    uint8_t *dest, const std::size_t *dest_offsets, const uint8_t *src,
+    const std::size_t *src_offsets, const std::size_t *src_lengths,
+    std::size_t count, const MTBase64::IndexTable& table, bool padding) {
+
+    MTBase64::SWARIndexTableAccessor::EncodeBatchBase64(
+        dest, dest_offsets, src, src_offsets, src_lengths, count, table,
+        padding);
+}
+
+void MTBase64::AVX2IndexTableAccessor::EncodeWrappedBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, std::size_t line_length,
+    const uint8_t *separator, std::size_t separator_len, bool padding) {
+
+    MTBase64::SWARIndexTableAccessor::EncodeWrappedBase64(
+        dest, src, src_len, table, line_length, separator, separator_len,
+        padding);
+}
+
+#endif /* __AVX2__ */
@@ -0,0 +1,513 @@
+#include "Implementations/Implementations.hpp"
+
+#include <cstring>
+
+/* Special thanks to:
+ * http://0x80.pl/notesen/2016-04-03-avx512-base64.html
+ */
+
+#if defined(__AVX512VBMI__) && defined(__AVX512BW__)
+
+/* GCC 12 builds the undefined inputs of the AVX-512 intrinsics with
+ * `_mm512_undefined_*`, which initialises a register with itself and warns
+ * wherever `vpermb`, `vpmultishiftqb` or a lane extract is inlined
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+
+bool MTBase64::VBMIIndexTableAccessor::Supported() {
+    return __builtin_cpu_supports("avx512vbmi") &&
+           __builtin_cpu_supports("avx512bw");
+}
+
+/*A lookup of 256 bytes, one for each byte value, in four registers*/
+struct ByteLookup {
+    __m512i quarters[4];
+};
+
+static inline ByteLookup LoadLookup(const uint8_t *lookup) {
+    return {{_mm512_loadu_si512(lookup + 0), _mm512_loadu_si512(lookup + 64),
+             _mm512_loadu_si512(lookup + 128),
+             _mm512_loadu_si512(lookup + 192)}};
+}
+
+/*Replaces each byte of `in` by its byte in `lookup`. `vpermi2b` only uses
+the lower 7 bits of each index, so the half of the lookup is selected by
+the top bit of `in`*/
+static inline __m512i LookupBytes(__m512i in, const ByteLookup& lookup) {
+    const __m512i lower = _mm512_permutex2var_epi8(
+        lookup.quarters[0], in, lookup.quarters[1]);
+    const __m512i upper = _mm512_permutex2var_epi8(
+        lookup.quarters[2], in, lookup.quarters[3]);
+    return _mm512_mask_blend_epi8(_mm512_movepi8_mask(in), lower, upper);
+}
+
+/*Decodes 64 characters to 48 bytes per iteration with any table. Each
+character is translated by permuting the 256 byte `d_perm` lookup, where
+characters outside of the table have the top bit set. The top bits are
+collected and checked once after the whole buffer has been decoded.
+
+The permutes never access memory depending on the input, so in constant
+time only the last characters are passed on to the constant time table
+implementation instead of the SWAR one*/
+template <bool kConstantTime>
+const char *MTBase64::VBMIIndexTableAccessor::Decode(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    if (padding && !MTBase64::ValidPaddedEncodedLength(src_len))
+        return kPaddedLengthError;
+
+    if (!padding && !MTBase64::ValidUnpaddedEncodedLength(src_len))
+        return kUnpaddedLengthError;
+
+    const ByteLookup perm = LoadLookup(table.d_perm.data());
+
+    /* Reverses the byte order of the 3 bytes that are left in each 32 bit
+     * lane and moves them to the lowest 48 bytes of the register
+     */
+    const __m512i pack = _mm512_setr_epi32(
+        0x06000102, 0x090a0405, 0x0c0d0e08, 0x16101112,
+        0x191a1415, 0x1c1d1e18, 0x26202122, 0x292a2425,
+        0x2c2d2e28, 0x36303132, 0x393a3435, 0x3c3d3e38,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000);
+
+    __m512i error = _mm512_setzero_si512();
+    std::size_t e_bc = 0, d_bc = 0;
+
+    /* Keeps the last quad, which may hold padding, for the SWAR
+     * implementation
+     */
+    while (src_len - e_bc >= 68) {
+        const __m512i in = _mm512_loadu_si512(src + e_bc);
+
+        const __m512i sextets = LookupBytes(in, perm);
+
+        error = _mm512_or_si512(error, sextets);
+
+        /* Merges the four 6 bit values of each lane into 24 bits */
+        const __m512i merged = _mm512_maddubs_epi16(
+            sextets, _mm512_set1_epi32(0x01400140));
+        __m512i out = _mm512_madd_epi16(merged, _mm512_set1_epi32(0x00011000));
+        out = _mm512_permutexvar_epi8(pack, out);
+
+        _mm512_mask_storeu_epi8(dest + d_bc, 0x0000FFFFFFFFFFFF, out);
+        e_bc += 64;
+        d_bc += 48;
+    }
+
+    const char *tail = kConstantTime ?
+        MTBase64::IndexTableAccessor::DecodeConstantTime(
+            dest + d_bc, src + e_bc, src_len - e_bc, table, padding) :
+        MTBase64::SWARIndexTableAccessor::DecodeBase64(
+            dest + d_bc, src + e_bc, src_len - e_bc, table, padding);
+    if (tail != nullptr)
+        return tail;
+
+    return (_mm512_movepi8_mask(error) != 0) ? kCharacterError : nullptr;
+}
+
+const char *MTBase64::VBMIIndexTableAccessor::DecodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    return Decode<false>(dest, src, src_len, table, padding);
+}
+
+const char *MTBase64::VBMIIndexTableAccessor::DecodeConstantTime(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    return Decode<true>(dest, src, src_len, table, padding);
+}
+
+/*Encodes the lowest 48 bytes of `in` to 64 characters with the 64
+characters of a table in `lookup`*/
+static inline __m512i EncodeChunk(__m512i in, __m512i lookup) {
+    /* Places the 3 bytes of each 32 bit lane as [b1, b0, b2, b1] */
+    const __m512i reshuffle = _mm512_setr_epi32(
+        0x01020001, 0x04050304, 0x07080607, 0x0a0b090a,
+        0x0d0e0c0d, 0x10110f10, 0x13141213, 0x16171516,
+        0x191a1819, 0x1c1d1b1c, 0x1f201e1f, 0x22232122,
+        0x25262425, 0x28292728, 0x2b2c2a2b, 0x2e2f2d2e);
+    /* Bit offsets of the four indices inside of each [b1, b0, b2, b1] */
+    const __m512i shifts = _mm512_set1_epi64(0x3036242a1016040a);
+
+    in = _mm512_permutexvar_epi8(reshuffle, in);
+
+    /* `vpermb` ignores the upper 2 bits of every extracted index */
+    const __m512i indices = _mm512_multishift_epi64_epi8(shifts, in);
+    return _mm512_permutexvar_epi8(indices, lookup);
+}
+
+/*Encodes 48 input bytes to 64 characters per iteration with any table. The
+64 characters of the table are used directly as the `vpermb` lookup. The
+last chunk shorter than 48 bytes is passed on to the SWAR
+implementation*/
+void MTBase64::VBMIIndexTableAccessor::EncodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    const __m512i lookup = _mm512_loadu_si512(table.e.data());
+    std::size_t d_bc = 0, e_bc = 0;
+
+    /* The masked load never touches bytes past the 48 being encoded, so
+     * the last full chunk is encoded here as well
+     */
+    while (src_len - d_bc >= 48) {
+        _mm512_storeu_si512(dest + e_bc, EncodeChunk(
+            _mm512_maskz_loadu_epi8(0x0000FFFFFFFFFFFF, src + d_bc), lookup));
+        d_bc += 48;
+        e_bc += 64;
+    }
+
+    MTBase64::SWARIndexTableAccessor::EncodeBase64(dest + e_bc, src + d_bc,
+                                                   src_len - d_bc, table,
+                                                   padding);
+}
+
+/*Encodes whole lines 48 bytes at a time like `EncodeBase64`, the last 3 to
+45 bytes of a line with a masked load and a masked store. Nothing past a
+line is read or written, so every line but the last one is encoded in
+registers*/
+void MTBase64::VBMIIndexTableAccessor::EncodeWrappedBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, std::size_t line_length,
+    const uint8_t *separator, std::size_t separator_len, bool padding) {
+
+    const __m512i lookup = _mm512_loadu_si512(table.e.data());
+    const std::size_t d_line = line_length / 4 * 3;
+    const std::size_t rest = d_line % 48;
+    const __mmask64 rest_load = (1ULL << rest) - 1;
+    const __mmask64 rest_store = (1ULL << (rest / 3 * 4)) - 1;
+
+    auto encode_line = [&](uint8_t *out, const uint8_t *in) {
+        std::size_t d_bc = 0;
+        for (; d_line - d_bc >= 48; d_bc += 48)
+            _mm512_storeu_si512(out + d_bc / 3 * 4, EncodeChunk(
+                _mm512_maskz_loadu_epi8(0x0000FFFFFFFFFFFF, in + d_bc),
+                lookup));
+        if (rest != 0)
+            _mm512_mask_storeu_epi8(out + d_bc / 3 * 4, rest_store,
+                EncodeChunk(_mm512_maskz_loadu_epi8(rest_load, in + d_bc),
+                            lookup));
+    };
+
+    MTBase64::EncodeLines(dest, src, src_len, line_length, separator,
+                          separator_len, padding, 0, encode_line,
+                          [&](uint8_t *out, const uint8_t *in,
+                              std::size_t len, bool pad) {
+                              MTBase64::VBMIIndexTableAccessor::EncodeBase64(
+                                  out, in, len, table, pad);
+                          });
+}
+
+/*Compacts 64 bytes per iteration. Ignored bytes are found by permuting the
+256 byte `map` the same way as `d_perm` in the decoder. Blocks without
+ignored bytes are stored as they are, the others are compacted 8 bytes at a
+time with `kCompactShuffles`. The last 0-63 bytes are passed on to the SWAR
+implementation*/
+std::size_t MTBase64::VBMIIndexTableAccessor::CompactBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    const ByteLookup map = LoadLookup(ignored.map.data());
+
+    std::size_t e_bc = 0, kept = 0;
+
+    /* The output never gets ahead of the input, so every store stays inside
+     * of the `src_len` bytes of `dest`
+     */
+    while (src_len - e_bc >= 64) {
+        const __m512i in = _mm512_loadu_si512(src + e_bc);
+
+        const __mmask64 skip = _mm512_movepi8_mask(LookupBytes(in, map));
+
+        if (skip == 0) {
+            _mm512_storeu_si512(dest + kept, in);
+            kept += 64;
+        } else {
+            const uint64_t keep = ~static_cast<uint64_t>(skip);
+
+            for (int group = 0; group < 8; ++group) {
+                const uint8_t mask = static_cast<uint8_t>(keep >> (8 * group));
+                const __m128i shuffled = _mm_shuffle_epi8(
+                    _mm_loadl_epi64(
+                        reinterpret_cast<const __m128i*>(src + e_bc + 8 * group)),
+                    _mm_cvtsi64_si128(static_cast<long long>(
+                        MTBase64::kCompactShuffles[mask])));
+
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + kept),
+                                 shuffled);
+                kept += __builtin_popcount(mask);
+            }
+        }
+
+        e_bc += 64;
+    }
+
+    return kept + MTBase64::SWARIndexTableAccessor::CompactBase64(
+        dest + kept, src + e_bc, src_len - e_bc, ignored);
+}
+
+/*Maps 64 characters per iteration through their index: `d_perm` of `from`
+is permuted like in the decoder and the indices are looked up in the 64
+characters of `to` with `vpermb`. The last 0-63 characters are passed on to
+the SWAR implementation*/
+const char *MTBase64::VBMIIndexTableAccessor::TranscodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::TranscodeMap& map) {
+
+    const ByteLookup perm = LoadLookup(map.from.d_perm.data());
+    const __m512i characters = _mm512_loadu_si512(map.to.e.data());
+
+    __m512i error = _mm512_setzero_si512();
+    std::size_t e_bc = 0;
+
+    while (src_len - e_bc >= 64) {
+        const __m512i in = _mm512_loadu_si512(src + e_bc);
+
+        const __m512i indices = LookupBytes(in, perm);
+
+        error = _mm512_or_si512(error, indices);
+
+        _mm512_storeu_si512(dest + e_bc,
+                            _mm512_permutexvar_epi8(indices, characters));
+        e_bc += 64;
+    }
+
+    const char *tail = MTBase64::SWARIndexTableAccessor::TranscodeBase64(
+        dest + e_bc, src + e_bc, src_len - e_bc, map);
+    if (tail != nullptr)
+        return tail;
+
+    if (_mm512_movepi8_mask(error) != 0)
+        return kTranscodeCharacterError;
+
+    return nullptr;
+}
+
+/*Checks 64 characters per iteration by permuting `d_perm` like in the
+decoder. The first invalid character is found in the mask of the block
+holding it. The last 0-63 characters are passed on to the SWAR
+implementation*/
+std::size_t MTBase64::VBMIIndexTableAccessor::ValidateBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    const ByteLookup perm = LoadLookup(table.d_perm.data());
+
+    std::size_t e_bc = 0;
+
+    while (src_len - e_bc >= 64) {
+        const __m512i in = _mm512_loadu_si512(src + e_bc);
+
+        const __mmask64 invalid = _mm512_movepi8_mask(LookupBytes(in, perm));
+
+        if (invalid != 0)
+            return e_bc + __builtin_ctzll(invalid);
+
+        e_bc += 64;
+    }
+
+    return e_bc + MTBase64::SWARIndexTableAccessor::ValidateBase64(
+        src + e_bc, src_len - e_bc, table);
+}
+
+/*Classifies 64 bytes per iteration like the compaction and counts the ones
+that are not ignored with `popcnt` on the byte mask. The last 0-63 bytes
+are passed on to the SWAR implementation*/
+std::size_t MTBase64::VBMIIndexTableAccessor::CountBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    const ByteLookup map = LoadLookup(ignored.map.data());
+
+    std::size_t e_bc = 0, skipped = 0;
+
+    while (src_len - e_bc >= 64) {
+        const __m512i in = _mm512_loadu_si512(src + e_bc);
+
+        const __mmask64 skip = _mm512_movepi8_mask(LookupBytes(in, map));
+
+        skipped += __builtin_popcountll(skip);
+        e_bc += 64;
+    }
+
+    return e_bc - skipped + MTBase64::SWARIndexTableAccessor::CountBase64(
+        src + e_bc, src_len - e_bc, ignored);
+}
+
+/*Permutes `d_perm` like the validation, the inverted sign mask of the 64
+looked up bytes is the word*/
+void MTBase64::VBMIIndexTableAccessor::ClassifyBase64(
+    uint64_t *valid, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    const ByteLookup perm = LoadLookup(table.d_perm.data());
+
+    std::size_t e_bc = 0;
+
+    while (src_len - e_bc >= 64) {
+        const __m512i in = _mm512_loadu_si512(src + e_bc);
+
+        valid[e_bc / 64] = ~_mm512_movepi8_mask(LookupBytes(in, perm));
+
+        e_bc += 64;
+    }
+
+    MTBase64::IndexTableAccessor::ClassifyBase64(valid + e_bc / 64, src + e_bc,
+                                                 src_len - e_bc, table);
+}
+
+/*Encodes four chunks of 12 bytes per iteration, one in each 128 bit lane.
+Each chunk is loaded with an 8 and a 4 byte load, so nothing past it is
+read. Lanes without a chunk repeat the first one and are not stored*/
+void MTBase64::VBMIIndexTableAccessor::EncodeBatchBase64(
+    uint8_t *dest, const std::size_t *dest_offsets, const uint8_t *src,
+    const std::size_t *src_offsets, const std::size_t *src_lengths,
+    std::size_t count, const MTBase64::IndexTable& table, bool padding) {
+
+    const __m512i lookup = _mm512_loadu_si512(table.e.data());
+    /* Places the 3 bytes of each 32 bit lane as [b1, b0, b2, b1] inside of
+     * every 128 bit lane
+     */
+    const __m512i reshuffle = _mm512_broadcast_i32x4(_mm_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    const __m512i shifts = _mm512_set1_epi64(0x3036242a1016040a);
+
+    auto load_chunk = [](const uint8_t *chunk) {
+        int32_t last;
+        std::memcpy(&last, chunk + 8, 4);
+        return _mm_insert_epi32(_mm_loadl_epi64(
+            reinterpret_cast<const __m128i*>(chunk)), last, 2);
+    };
+
+    auto encode_lanes = [&](const uint8_t *const *srcs, uint8_t *const *dests,
+                            int lanes) {
+        __m512i in = _mm512_castsi128_si512(load_chunk(srcs[0]));
+        in = _mm512_inserti32x4(in, load_chunk(srcs[lanes > 1 ? 1 : 0]), 1);
+        in = _mm512_inserti32x4(in, load_chunk(srcs[lanes > 2 ? 2 : 0]), 2);
+        in = _mm512_inserti32x4(in, load_chunk(srcs[lanes > 3 ? 3 : 0]), 3);
+        in = _mm512_shuffle_epi8(in, reshuffle);
+
+        const __m512i indices = _mm512_multishift_epi64_epi8(shifts, in);
+        const __m512i out = _mm512_permutexvar_epi8(indices, lookup);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dests[0]),
+                         _mm512_castsi512_si128(out));
+        if (lanes > 1)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dests[1]),
+                             _mm512_extracti32x4_epi32(out, 1));
+        if (lanes > 2)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dests[2]),
+                             _mm512_extracti32x4_epi32(out, 2));
+        if (lanes > 3)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dests[3]),
+                             _mm512_extracti32x4_epi32(out, 3));
+    };
+
+    MTBase64::EncodeBatchChunks<4>(dest, dest_offsets, src, src_offsets,
+                                   src_lengths, count, table, padding,
+                                   encode_lanes);
+}
+
+#else
+
+/*Built without the instruction set, the dispatcher never picks this kernel*/
+bool MTBase64::VBMIIndexTableAccessor::Supported() {
+    return false;
+}
+
+const char *MTBase64::VBMIIndexTableAccessor::DecodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    return MTBase64::SWARIndexTableAccessor::DecodeBase64(dest, src, src_len,
+                                                          table, padding);
+}
+
+void MTBase64::VBMIIndexTableAccessor::EncodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    MTBase64::SWARIndexTableAccessor::EncodeBase64(dest, src, src_len, table,
+                                                   padding);
+}
+
+std::size_t MTBase64::VBMIIndexTableAccessor::CompactBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    return MTBase64::SWARIndexTableAccessor::CompactBase64(dest, src, src_len,
+                                                           ignored);
+}
+
+const char *MTBase64::VBMIIndexTableAccessor::TranscodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::TranscodeMap& map) {
+
+    return MTBase64::SWARIndexTableAccessor::TranscodeBase64(dest, src, src_len,
+                                                             map);
+}
+
+std::size_t MTBase64::VBMIIndexTableAccessor::ValidateBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    return MTBase64::SWARIndexTableAccessor::ValidateBase64(src, src_len,
+                                                            table);
+}
+
+std::size_t MTBase64::VBMIIndexTableAccessor::CountBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    return MTBase64::SWARIndexTableAccessor::CountBase64(src, src_len, ignored);
+}
+
+void MTBase64::VBMIIndexTableAccessor::ClassifyBase64(
+    uint64_t *valid, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    MTBase64::SWARIndexTableAccessor::ClassifyBase64(valid, src, src_len,
+                                                     table);
+}
+
+const char *MTBase64::VBMIIndexTableAccessor::DecodeConstantTime(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    return MTBase64::SWARIndexTableAccessor::DecodeConstantTime(
+        dest, src, src_len, table, padding);
+}
+
+void MTBase64::VBMIIndexTableAccessor::EncodeBatchBase64(
+    uint8_t *dest, const std::size_t *dest_offsets, const uint8_t *src,
+    const std::size_t *src_offsets, const std::size_t *src_lengths,
+    std::size_t count, const MTBase64::IndexTable& table, bool padding) {
+
+    MTBase64::SWARIndexTableAccessor::EncodeBatchBase64(
+        dest, dest_offsets, src, src_offsets, src_lengths, count, table,
+        padding);
+}
+
+void MTBase64::VBMIIndexTableAccessor::EncodeWrappedBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, std::size_t line_length,
+    const uint8_t *separator, std::size_t separator_len, bool padding) {
+
+    MTBase64::SWARIndexTableAccessor::EncodeWrappedBase64(
+        dest, src, src_len, table, line_length, separator, separator_len,
+        padding);
+}
+
+#endif /* __AVX512VBMI__ && __AVX512BW__ */
@@ -1,189 +1,398 @@
-#include "MTBase64.hpp"
-
-
-struct MTBase64::IndexTableAccessor {
-    /*Reverse chunking of four 6 bit bytes to three 8 bit bytes by using reverse
-    lookup table and padding checking*/
-    static void DecodeBase64(uint8_t *dest, const uint8_t *src, std::size_t src_len,
-                             const MTBase64::IndexTable& table,
-                             bool padding = true) {
-
-        /* `src_len == 0` is taken in account in `MTBase64::ValidPaddedEncodedLength`
-         * and `MTBase64::ValidUnpaddedEncodedLength`
-         */
-        if (padding && !MTBase64::ValidPaddedEncodedLength(src_len))
-            throw MTBase64::MTBase64Exception(
-            __FILE__, __FUNCTION__, __LINE__,
-            MTBase64::ErrorCodeTable::kNotValidBase64,
-            "Not valid base64 encoding length when padding is being used.");
-
-        if (!padding && !MTBase64::ValidUnpaddedEncodedLength(src_len))
-            throw MTBase64::MTBase64Exception(
-            __FILE__, __FUNCTION__, __LINE__,
-            MTBase64::ErrorCodeTable::kNotValidBase64,
-            "Not valid base64 encoding length when padding is not being used.");
-
-        uint8_t padding_byte = table.GetPadding();
-        if (src[src_len-1] != padding_byte && src[src_len-2] == padding_byte)
-            throw MTBase64::MTBase64Exception(
-            __FILE__, __FUNCTION__, __LINE__,
-            MTBase64::ErrorCodeTable::kNotValidBase64,
-            "If the penulminate byte is padding, the last one must be padding too.");    
+#include "Implementations/Implementations.hpp"
+
+#include <cstring>
+
+
+/*Reverse chunking of four 6 bit bytes to three 8 bit bytes by using reverse
+lookup table and padding checking*/
+const char *MTBase64::IndexTableAccessor::DecodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    /* `src_len == 0` is taken in account in `MTBase64::ValidPaddedEncodedLength`
+     * and `MTBase64::ValidUnpaddedEncodedLength`
+     */
+    if (padding && !MTBase64::ValidPaddedEncodedLength(src_len))
+        return kPaddedLengthError;
+
+    if (!padding && !MTBase64::ValidUnpaddedEncodedLength(src_len))
+        return kUnpaddedLengthError;
+
+    uint8_t padding_byte = table.GetPadding();
+    if (src[src_len-1] != padding_byte && src[src_len-2] == padding_byte)
+        return "If the penulminate byte is padding, the last one must be "
+               "padding too.";
+
+    if (padding) {
+        src_len -= src[src_len-1] == padding_byte;
+        src_len -= src[src_len-1] == padding_byte;
+    }
+
+    /* If the source is % 4 = 0, the last chunk will be treated differently to
+     * prevent overflow due to copying an integer holding 3 valid bytes to the
+     * destination.
+     */
+    std::size_t rest = src_len & 3, chunks = (rest == 0) ? src_len / 4 - 1 : src_len / 4;
+    std::size_t e_bc = 0;
+    uint32_t db;
+    uint8_t eb0, eb1, eb2, eb3;
+
+    for (std::size_t ch = 0; ch < chunks; ++ch) {
+        eb0 = src[e_bc++];
+        eb1 = src[e_bc++];
+        eb2 = src[e_bc++];
+        eb3 = src[e_bc++];
+
+        db = table.d0.at(eb0)|table.d1.at(eb1)|table.d2.at(eb2)|table.d3.at(eb3);
+        if (db >= MTBASE64__BADCHAR)
+            return kCharacterError;
+    
+        std::memcpy(dest, &db, 4);
+        dest += 3;
+    }
+
+    switch (rest) {
+    case 0: /* We treat the last % 4 = 0 chunk differently to prevent overflow */
+        eb0 = src[e_bc++];
+        eb1 = src[e_bc++];
+        eb2 = src[e_bc++];
+        eb3 = src[e_bc++];
+
+        db = table.d0.at(eb0)|table.d1.at(eb1)|table.d2.at(eb2)|table.d3.at(eb3);
+        if (db >= MTBASE64__BADCHAR)
+            return kCharacterError;
+        
+        /* Prevent overflow on the last chunk */
+        std::memcpy(dest, &db, 3);
+        break;
+    case 1:
+        if (padding)
+            return "Rest of 1 when decoding paddded data. Something bad "
+                   "happened.";
+        eb0 = src[e_bc];
+        
+        db = table.d0.at(eb0);
+        if (db >= MTBASE64__BADCHAR)
+            return kCharacterError;
+
+        std::memcpy(dest, &db, 1);
+        break;
+    case 2:
+        eb0 = src[e_bc++];
+        eb1 = src[e_bc++];
+
+        db = table.d0.at(eb0)|table.d1.at(eb1);
+        if (db >= MTBASE64__BADCHAR)
+            return kCharacterError;
+
+        std::memcpy(dest, &db, 1);
+        break;
+    case 3:
+        eb0 = src[e_bc++];
+        eb1 = src[e_bc++];
+        eb2 = src[e_bc++];
+
+        db = table.d0.at(eb0)|table.d1.at(eb1)|table.d2.at(eb2);
+        if (db >= MTBASE64__BADCHAR)
+            return kCharacterError;
+
+        std::memcpy(dest, &db, 2);
+        break;
+    default:
+        break;
+    }
+
+    return nullptr;
+}
+
+/*Splits the encoding process into the encoding of whole 3-byte chunks and the
+encoding of the last 1-2 byte chunk with padding at the end if used. Nothing
+is written for `src_len == 0`, like in the SIMD kernels*/
+void MTBase64::IndexTableAccessor::EncodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    uint8_t padding_byte    = table.GetPadding(),   remainder   = src_len % 3;
+    size_t d_bc             = 0,                    e_bc        = 0;
+
+
+    uint8_t db1, db2, db3;
+    /*The loop bellow encodes only whole chunks of 3 bytes*/
+    while (d_bc < src_len - remainder) {
+        db1 = src[d_bc++];
+        db2 = src[d_bc++];
+        db3 = src[d_bc++];
+
+        dest[e_bc++] = table.e0.at(db1);
+        dest[e_bc++] = table.e1.at(((db1 & 0x03) << 4) | ((db2 >> 4) & 0x0F));
+        dest[e_bc++] = table.e1.at(((db2 & 0x0F) << 2) | ((db3 >> 6) & 0x03));
+        dest[e_bc++] = table.e2.at(db3);
+    }
+
+    switch (remainder) {
+    case 0:
+        break;
+    case 1:
+        db1 = src[d_bc++];
+
+        dest[e_bc++] = table.e0.at(db1);
+        dest[e_bc++] = table.e1.at((db1 & 0x03) << 4);
 
         if (padding) {
-            src_len -= src[src_len-1] == padding_byte;
-            src_len -= src[src_len-1] == padding_byte;
+            dest[e_bc++] = padding_byte;
+            dest[e_bc++] = padding_byte;
         }
+        break;
+    case 2:
+        db1 = src[d_bc++];
+        db2 = src[d_bc++];
 
-        /* If the source is % 4 = 0, the last chunk will be treated differently to
-         * prevent overflow due to copying an integer holding 3 valid bytes to the
-         * destination.
-         */
-        std::size_t rest = src_len & 3, chunks = (rest == 0) ? src_len / 4 - 1 : src_len / 4;
-        std::size_t e_bc = 0, d_bc = 0;
-        uint32_t db;
-        uint8_t eb0, eb1, eb2, eb3;
-
-        for (std::size_t ch = 0; ch < chunks; ++ch) {
-            eb0 = src[e_bc++];
-            eb1 = src[e_bc++];
-            eb2 = src[e_bc++];
-            eb3 = src[e_bc++];
-
-            db = table.d0.at(eb0)|table.d1.at(eb1)|table.d2.at(eb2)|table.d3.at(eb3);
-            if (db >= MTBASE64__BADCHAR)
-                throw MTBase64::MTBase64Exception(
-                __FILE__, __FUNCTION__, __LINE__,
-                MTBase64::ErrorCodeTable::kNotValidBase64,
-                "Base64 encoded byte was not found in given table during decoding.");
+        dest[e_bc++] = table.e0.at(db1);
+        dest[e_bc++] = table.e1.at(((db1 & 0x03) << 4) | ((db2 >> 4) & 0x0F));
+        dest[e_bc++] = table.e2.at((db2 & 0x0F) << 2);
         
-            std::memcpy(dest, &db, 4);
-            dest += 3;
+        if (padding) {
+            dest[e_bc++] = padding_byte;
         }
+        break;
+    default:
+        break;
+    }
+}
+MTBase64::IgnoredBytes::IgnoredBytes(const std::string& bytes)
+    : map(), bitmap() {
 
-        switch (rest) {
-        case 0: /* We treat the last % 4 = 0 chunk differently to prevent overflow */
-            eb0 = src[e_bc++];
-            eb1 = src[e_bc++];
-            eb2 = src[e_bc++];
-            eb3 = src[e_bc++];
-
-            db = table.d0.at(eb0)|table.d1.at(eb1)|table.d2.at(eb2)|table.d3.at(eb3);
-            if (db >= MTBASE64__BADCHAR)
-                throw MTBase64::MTBase64Exception(
-                __FILE__, __FUNCTION__, __LINE__,
-                MTBase64::ErrorCodeTable::kNotValidBase64,
-                "Base64 encoded byte was not found in given table during decoding.");
-            
-            /* Prevent overflow on the last chunk */
-            std::memcpy(dest, &db, 3);
-            break;
-        case 1:
-            if (padding)
-                throw MTBase64::MTBase64Exception(
-                __FILE__, __FUNCTION__, __LINE__,
-                MTBase64::ErrorCodeTable::kNotValidBase64,
-                "Rest of 1 when decoding paddded data. Something bad happened.");
-            eb0 = src[e_bc];
-            
-            db = table.d0.at(eb0);
-            if (db >= MTBASE64__BADCHAR)
-                throw MTBase64::MTBase64Exception(
-                __FILE__, __FUNCTION__, __LINE__,
-                MTBase64::ErrorCodeTable::kNotValidBase64,
-                "Base64 encoded byte was not found in given table during decoding.");
-
-            std::memcpy(dest, &db, 1);
-            break;
-        case 2:
-            eb0 = src[e_bc++];
-            eb1 = src[e_bc++];
-
-            db = table.d0.at(eb0)|table.d1.at(eb1);
-            if (db >= MTBASE64__BADCHAR)
-                throw MTBase64::MTBase64Exception(
-                __FILE__, __FUNCTION__, __LINE__,
-                MTBase64::ErrorCodeTable::kNotValidBase64,
-                "Base64 encoded byte was not found in given table during decoding.");
-
-            std::memcpy(dest, &db, 1);
-            break;
-        case 3:
-            eb0 = src[e_bc++];
-            eb1 = src[e_bc++];
-            eb2 = src[e_bc++];
-
-            db = table.d0.at(eb0)|table.d1.at(eb1)|table.d2.at(eb2);
-            if (db >= MTBASE64__BADCHAR)
-                throw MTBase64::MTBase64Exception(
-                __FILE__, __FUNCTION__, __LINE__,
-                MTBase64::ErrorCodeTable::kNotValidBase64,
-                "Base64 encoded byte was not found in given table during decoding.");
-
-            std::memcpy(dest, &db, 2);
-            break;
-        default:
-            break;
-        }
+    for (char c : bytes) {
+        const uint8_t byte = static_cast<uint8_t>(c);
+        map[byte] = 0x80;
+        bitmap[byte >> 3] |= static_cast<uint8_t>(1 << (byte & 7));
     }
+}
 
-    /*Splits the encoding process into the encoding of whole 3-byte chunks and the
-    encoding of the last 1-2 byte chunk with padding at the end if used*/
-    static void EncodeBase64(uint8_t *dest, const uint8_t *src, std::size_t src_len,
-                             const MTBase64::IndexTable& table,
-                             bool padding = true) {
-
-        if(src_len == 0)
-            throw MTBase64::MTBase64Exception(
-            __FILE__, __FUNCTION__, __LINE__,
-            MTBase64::ErrorCodeTable::kIllegalFunctionCall,
-            "input buffer length is 0.");
-
-        uint8_t padding_byte    = table.GetPadding(),   remainder   = src_len % 3;
-        size_t d_bc             = 0,                    e_bc        = 0;
-
-
-        uint8_t db1, db2, db3;
-        /*The loop bellow encodes only whole chunks of 3 bytes*/
-        while (d_bc < src_len - remainder) {
-            db1 = src[d_bc++];
-            db2 = src[d_bc++];
-            db3 = src[d_bc++];
-
-            dest[e_bc++] = table.e0.at(db1);
-            dest[e_bc++] = table.e1.at(((db1 & 0x03) << 4) | ((db2 >> 4) & 0x0F));
-            dest[e_bc++] = table.e1.at(((db2 & 0x0F) << 2) | ((db3 >> 6) & 0x03));
-            dest[e_bc++] = table.e2.at(db3);
-        }
+static constexpr std::array<uint64_t, 256> MakeCompactShuffles() {
+    std::array<uint64_t, 256> shuffles{};
+
+    for (unsigned mask = 0; mask < 256; ++mask) {
+        uint64_t shuffle = 0;
+        unsigned kept = 0;
+
+        for (unsigned i = 0; i < 8; ++i)
+            if (mask & (1 << i))
+                shuffle |= static_cast<uint64_t>(i) << (8 * kept++);
+
+        shuffles[mask] = shuffle;
+    }
+
+    return shuffles;
+}
+
+/*Constant initialized, so it is usable from static initializers too*/
+const std::array<uint64_t, 256> MTBase64::kCompactShuffles =
+    MakeCompactShuffles();
 
-        switch (remainder) {
-        case 0:
-            break;
-        case 1:
-            db1 = src[d_bc++];
+/*Copies every byte of `src` that is not ignored to `dest` and returns their
+count. Every byte is stored and the output position only advances for kept
+bytes, so no more than `src_len` bytes of `dest` are written*/
+std::size_t MTBase64::IndexTableAccessor::CompactBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < src_len; ++i) {
+        dest[kept] = src[i];
+        kept += ignored.map[src[i]] == 0;
+    }
 
-            dest[e_bc++] = table.e0.at(db1);
-            dest[e_bc++] = table.e1.at((db1 & 0x03) << 4);
+    return kept;
+}
 
-            if (padding) {
-                dest[e_bc++] = padding_byte;
-                dest[e_bc++] = padding_byte;
+MTBase64::TranscodeMap::TranscodeMap(const MTBase64::IndexTable& from_table,
+                                     const MTBase64::IndexTable& to_table)
+    : from(from_table), to(to_table), map(), invalid(), valid(), rows(0) {
+
+    invalid.fill(0x80);
+    for (uint8_t index = 0; index < 64; ++index) {
+        const uint8_t c = from.Lookup(index);
+
+        map[c] = to.Lookup(index);
+        invalid[c] = 0;
+        valid[c >> 3] |= static_cast<uint8_t>(1 << (c & 7));
+        rows |= static_cast<uint16_t>(1 << (c >> 4));
+    }
+}
+
+/*Maps every character of `src` to `dest`. Characters outside of `from` are
+collected and reported after the whole buffer has been mapped*/
+const char *MTBase64::IndexTableAccessor::TranscodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::TranscodeMap& map) {
+
+    uint8_t error = 0;
+    for (std::size_t i = 0; i < src_len; ++i) {
+        dest[i] = map.map[src[i]];
+        error |= map.invalid[src[i]];
+    }
+
+    return (error != 0) ? kTranscodeCharacterError : nullptr;
+}
+
+/*Returns the offset of the first byte of `src` that is not a character of
+`table`, or `src_len` if there is none*/
+std::size_t MTBase64::IndexTableAccessor::ValidateBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    for (std::size_t i = 0; i < src_len; ++i)
+        if (table.d0[src[i]] == MTBASE64__BADCHAR)
+            return i;
+
+    return src_len;
+}
+
+/*Returns the number of bytes of `src` that are not ignored*/
+std::size_t MTBase64::IndexTableAccessor::CountBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < src_len; ++i)
+        kept += ignored.map[src[i]] == 0;
+
+    return kept;
+}
+
+/*Sets bit `i % 64` of `valid[i / 64]` for each character of `table` at
+`src[i]`. Bits past `src_len` in the last word are cleared*/
+void MTBase64::IndexTableAccessor::ClassifyBase64(
+    uint64_t *valid, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    for (std::size_t e_bc = 0; e_bc < src_len; e_bc += 64) {
+        std::size_t chunk = (src_len - e_bc < 64) ? src_len - e_bc : 64;
+        uint64_t word = 0;
+
+        for (std::size_t i = 0; i < chunk; ++i)
+            word |= static_cast<uint64_t>(
+                table.d0[src[e_bc + i]] != MTBASE64__BADCHAR) << i;
+
+        valid[e_bc / 64] = word;
+    }
+}
+
+/*Decodes without branches or memory accesses depending on the characters.
+Each character is compared with the runs of the decode plan of the table
+or, without a plan, with all of its 64 characters. Invalid characters are
+collected and reported after the whole buffer has been decoded. Only the
+number of trailing padding characters is branched on, it is given away by
+the decoded length anyway*/
+const char *MTBase64::IndexTableAccessor::DecodeConstantTime(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    if (padding && !MTBase64::ValidPaddedEncodedLength(src_len))
+        return kPaddedLengthError;
+
+    if (!padding && !MTBase64::ValidUnpaddedEncodedLength(src_len))
+        return kUnpaddedLengthError;
+
+    if (padding) {
+        src_len -= src[src_len-1] == table.GetPadding();
+        src_len -= src[src_len-1] == table.GetPadding();
+    }
+
+    /* The index of `c` with 0x80 set when it is not in the table. A mask is
+     * all ones when the unsigned difference wrapped below zero
+     */
+    auto sextet = [&table](uint32_t c) -> uint32_t {
+        uint32_t index = 0, found = 0;
+
+        if (table.d_plan_size_ > 0) {
+            for (uint8_t r = 0; r < table.d_plan_size_; ++r) {
+                const MTBase64::IndexTable::DecodeRange& range = table.d_plan[r];
+                const uint32_t offset = (c - range.start) & 0xFF;
+                const uint32_t inside =
+                    0 - ((offset - range.length) >> 31);
+
+                index |= inside & (offset + range.index);
+                found |= inside;
             }
-            break;
-        case 2:
-            db1 = src[d_bc++];
-            db2 = src[d_bc++];
-
-            dest[e_bc++] = table.e0.at(db1);
-            dest[e_bc++] = table.e1.at(((db1 & 0x03) << 4) | ((db2 >> 4) & 0x0F));
-            dest[e_bc++] = table.e2.at((db2 & 0x0F) << 2);
-            
-            if (padding) {
-                dest[e_bc++] = padding_byte;
+        } else {
+            for (uint32_t i = 0; i < 64; ++i) {
+                const uint32_t equal = 0 - (((c ^ table.e[i]) - 1) >> 31);
+
+                index |= equal & i;
+                found |= equal;
             }
-            break;
-        default:
-            break;
         }
+
+        return (index & 0x3F) | (~found & 0x80);
+    };
+
+    std::size_t e_bc = 0, d_bc = 0;
+    uint32_t error = 0;
+
+    while (src_len - e_bc >= 4) {
+        const uint32_t s0 = sextet(src[e_bc + 0]), s1 = sextet(src[e_bc + 1]);
+        const uint32_t s2 = sextet(src[e_bc + 2]), s3 = sextet(src[e_bc + 3]);
+        error |= s0 | s1 | s2 | s3;
+
+        const uint32_t bytes = (s0 << 18) | (s1 << 12) | (s2 << 6) | s3;
+        dest[d_bc + 0] = static_cast<uint8_t>(bytes >> 16);
+        dest[d_bc + 1] = static_cast<uint8_t>(bytes >> 8);
+        dest[d_bc + 2] = static_cast<uint8_t>(bytes);
+
+        e_bc += 4;
+        d_bc += 3;
     }
-};
\ No newline at end of file
+
+    /* Never left by a valid length, kept in case the checks above change */
+    const std::size_t rest = src_len - e_bc;
+    if (rest == 1)
+        error |= 0x80;
+
+    if (rest >= 2) {
+        const uint32_t s0 = sextet(src[e_bc + 0]), s1 = sextet(src[e_bc + 1]);
+        const uint32_t s2 = (rest == 3) ? sextet(src[e_bc + 2]) : 0;
+        error |= s0 | s1 | s2;
+
+        const uint32_t bytes = (s0 << 18) | (s1 << 12) | (s2 << 6);
+        dest[d_bc + 0] = static_cast<uint8_t>(bytes >> 16);
+        if (rest == 3)
+            dest[d_bc + 1] = static_cast<uint8_t>(bytes >> 8);
+    }
+
+    return (error & 0x80) ? kCharacterError : nullptr;
+}
+
+/*Encodes the buffers of a batch one after the other, empty ones are
+skipped*/
+void MTBase64::IndexTableAccessor::EncodeBatchBase64(
+    uint8_t *dest, const std::size_t *dest_offsets, const uint8_t *src,
+    const std::size_t *src_offsets, const std::size_t *src_lengths,
+    std::size_t count, const MTBase64::IndexTable& table, bool padding) {
+
+    for (std::size_t i = 0; i < count; ++i)
+        if (src_lengths[i] > 0)
+            MTBase64::IndexTableAccessor::EncodeBase64(
+                dest + dest_offsets[i], src + src_offsets[i], src_lengths[i],
+                table, padding);
+}
+
+/*Encodes every line with the table encoder right where it belongs in `dest`*/
+void MTBase64::IndexTableAccessor::EncodeWrappedBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, std::size_t line_length,
+    const uint8_t *separator, std::size_t separator_len, bool padding) {
+
+    auto encode = [&](uint8_t *out, const uint8_t *in, std::size_t len,
+                      bool pad) {
+        MTBase64::IndexTableAccessor::EncodeBase64(out, in, len, table, pad);
+    };
+
+    MTBase64::EncodeLines(dest, src, src_len, line_length, separator,
+                          separator_len, padding, 0,
+                          [&](uint8_t *out, const uint8_t *in) {
+                              encode(out, in, line_length / 4 * 3, false);
+                          },
+                          encode);
+}
@@ -0,0 +1,271 @@
+#include "Implementations/Implementations.hpp"
+
+#include <cstring>
+
+
+/*Decodes 8 characters to 6 bytes per iteration by merging two quads from
+`d0`..`d3` into a 64 bit integer that is stored at once. Characters outside
+of the table are collected and checked after the whole buffer has been
+decoded. The last 8-15 characters (including the padding) are passed on to
+the table implementation*/
+const char *MTBase64::SWARIndexTableAccessor::DecodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    if (padding && !MTBase64::ValidPaddedEncodedLength(src_len))
+        return kPaddedLengthError;
+
+    if (!padding && !MTBase64::ValidUnpaddedEncodedLength(src_len))
+        return kUnpaddedLengthError;
+
+    const uint32_t *d0 = table.d0.data(), *d1 = table.d1.data();
+    const uint32_t *d2 = table.d2.data(), *d3 = table.d3.data();
+
+    std::size_t e_bc = 0, d_bc = 0;
+    uint32_t error = 0;
+
+    /* 8 bytes are stored for every 6 decoded bytes. With at least 8 more
+     * characters after the block the store stays inside of the decoded
+     * length and the padding stays outside of the block
+     */
+    while (src_len - e_bc >= 16) {
+        const uint8_t *in = src + e_bc;
+        const uint32_t q0 = d0[in[0]] | d1[in[1]] | d2[in[2]] | d3[in[3]];
+        const uint32_t q1 = d0[in[4]] | d1[in[5]] | d2[in[6]] | d3[in[7]];
+        error |= q0 | q1;
+
+        /* Little endian only, both quads hold their 3 bytes in memory order */
+        const uint64_t out = static_cast<uint64_t>(q0 & 0x00FFFFFF) |
+                             (static_cast<uint64_t>(q1 & 0x00FFFFFF) << 24);
+        std::memcpy(dest + d_bc, &out, 8);
+
+        e_bc += 8;
+        d_bc += 6;
+    }
+
+    const char *tail = MTBase64::IndexTableAccessor::DecodeBase64(
+        dest + d_bc, src + e_bc, src_len - e_bc, table, padding);
+    if (tail != nullptr)
+        return tail;
+
+    return (error >= MTBASE64__BADCHAR) ? kCharacterError : nullptr;
+}
+
+/*Encodes the 6 bytes at `src` to 8 characters, loading 8 bytes*/
+static inline void EncodeGroup(uint8_t *dest, const uint8_t *src,
+                               const uint16_t *e_pairs) {
+    uint64_t in;
+    std::memcpy(&in, src, 8);
+    in = be64toh(in);
+
+    const uint64_t out =
+        (static_cast<uint64_t>(e_pairs[(in >> 52) & 0xFFF]) << 0)  |
+        (static_cast<uint64_t>(e_pairs[(in >> 40) & 0xFFF]) << 16) |
+        (static_cast<uint64_t>(e_pairs[(in >> 28) & 0xFFF]) << 32) |
+        (static_cast<uint64_t>(e_pairs[(in >> 16) & 0xFFF]) << 48);
+    std::memcpy(dest, &out, 8);
+}
+
+/*Encodes 6 input bytes to 8 characters per iteration. The input is loaded
+as one big endian 64 bit integer from which four 12 bit indices are taken.
+Each of them looks up two characters in `e_pairs` and the 8 characters are
+stored with a single 8 byte store. The last chunk shorter than 8 bytes is
+passed on to the table implementation*/
+void MTBase64::SWARIndexTableAccessor::EncodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    const uint16_t *e_pairs = table.e_pairs.data();
+    std::size_t d_bc = 0, e_bc = 0;
+
+    /* 8 bytes are loaded for every 6 being encoded, which also leaves a non
+     * empty remainder for the table implementation
+     */
+    while (src_len - d_bc >= 8) {
+        EncodeGroup(dest + e_bc, src + d_bc, e_pairs);
+        d_bc += 6;
+        e_bc += 8;
+    }
+
+    MTBase64::IndexTableAccessor::EncodeBase64(dest + e_bc, src + d_bc,
+                                               src_len - d_bc, table,
+                                               padding);
+}
+
+/*Copies 8 bytes at once while none of them is ignored, blocks holding an
+ignored byte are compacted by the table implementation*/
+std::size_t MTBase64::SWARIndexTableAccessor::CompactBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    const uint8_t *map = ignored.map.data();
+    std::size_t e_bc = 0, kept = 0;
+
+    while (src_len - e_bc >= 8) {
+        const uint8_t *in = src + e_bc;
+        const uint8_t skip = map[in[0]] | map[in[1]] | map[in[2]] | map[in[3]] |
+                             map[in[4]] | map[in[5]] | map[in[6]] | map[in[7]];
+
+        if (skip == 0) {
+            std::memmove(dest + kept, in, 8);
+            kept += 8;
+        } else {
+            kept += MTBase64::IndexTableAccessor::CompactBase64(dest + kept, in,
+                                                                8, ignored);
+        }
+
+        e_bc += 8;
+    }
+
+    return kept + MTBase64::IndexTableAccessor::CompactBase64(
+        dest + kept, src + e_bc, src_len - e_bc, ignored);
+}
+
+/*Maps 8 characters per iteration and stores them with a single 8 byte
+store. The last 0-7 characters are passed on to the table
+implementation*/
+const char *MTBase64::SWARIndexTableAccessor::TranscodeBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::TranscodeMap& map) {
+
+    const uint8_t *m = map.map.data(), *invalid = map.invalid.data();
+    std::size_t e_bc = 0;
+    uint8_t error = 0;
+
+    while (src_len - e_bc >= 8) {
+        const uint8_t *in = src + e_bc;
+        const uint64_t out =
+            (static_cast<uint64_t>(m[in[0]]) << 0)  |
+            (static_cast<uint64_t>(m[in[1]]) << 8)  |
+            (static_cast<uint64_t>(m[in[2]]) << 16) |
+            (static_cast<uint64_t>(m[in[3]]) << 24) |
+            (static_cast<uint64_t>(m[in[4]]) << 32) |
+            (static_cast<uint64_t>(m[in[5]]) << 40) |
+            (static_cast<uint64_t>(m[in[6]]) << 48) |
+            (static_cast<uint64_t>(m[in[7]]) << 56);
+        error |= invalid[in[0]] | invalid[in[1]] | invalid[in[2]] |
+                 invalid[in[3]] | invalid[in[4]] | invalid[in[5]] |
+                 invalid[in[6]] | invalid[in[7]];
+
+        std::memcpy(dest + e_bc, &out, 8);
+        e_bc += 8;
+    }
+
+    const char *tail = MTBase64::IndexTableAccessor::TranscodeBase64(
+        dest + e_bc, src + e_bc, src_len - e_bc, map);
+    if (tail != nullptr)
+        return tail;
+
+    return (error != 0) ? kTranscodeCharacterError : nullptr;
+}
+
+/*Checks 8 characters per iteration with `d0`, only the block holding the
+first invalid character is searched byte by byte*/
+std::size_t MTBase64::SWARIndexTableAccessor::ValidateBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    const uint32_t *d0 = table.d0.data();
+    std::size_t e_bc = 0;
+
+    while (src_len - e_bc >= 8) {
+        const uint8_t *in = src + e_bc;
+        const uint32_t merged = d0[in[0]] | d0[in[1]] | d0[in[2]] | d0[in[3]] |
+                                d0[in[4]] | d0[in[5]] | d0[in[6]] | d0[in[7]];
+
+        if (merged >= MTBASE64__BADCHAR)
+            break;
+
+        e_bc += 8;
+    }
+
+    return e_bc + MTBase64::IndexTableAccessor::ValidateBase64(
+        src + e_bc, src_len - e_bc, table);
+}
+
+/*Adds up the `map` entries of 8 bytes per iteration, each ignored byte adds
+0x80 to the sum*/
+std::size_t MTBase64::SWARIndexTableAccessor::CountBase64(
+    const uint8_t *src, std::size_t src_len,
+    const MTBase64::IgnoredBytes& ignored) {
+
+    const uint8_t *map = ignored.map.data();
+    std::size_t e_bc = 0, skipped = 0;
+
+    while (src_len - e_bc >= 8) {
+        const uint8_t *in = src + e_bc;
+        skipped += map[in[0]] + map[in[1]] + map[in[2]] + map[in[3]] +
+                   map[in[4]] + map[in[5]] + map[in[6]] + map[in[7]];
+        e_bc += 8;
+    }
+
+    return e_bc - (skipped >> 7) + MTBase64::IndexTableAccessor::CountBase64(
+        src + e_bc, src_len - e_bc, ignored);
+}
+
+/*Every byte needs a lookup of its own to become a bit, which the table
+implementation already does*/
+void MTBase64::SWARIndexTableAccessor::ClassifyBase64(
+    uint64_t *valid, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table) {
+
+    MTBase64::IndexTableAccessor::ClassifyBase64(valid, src, src_len, table);
+}
+
+/*Table lookups depend on the characters, so the constant time decoding is
+left to the table implementation*/
+const char *MTBase64::SWARIndexTableAccessor::DecodeConstantTime(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, bool padding) {
+
+    return MTBase64::IndexTableAccessor::DecodeConstantTime(dest, src, src_len,
+                                                            table, padding);
+}
+
+/*Too narrow for interleaving buffers, encodes them one after the other*/
+void MTBase64::SWARIndexTableAccessor::EncodeBatchBase64(
+    uint8_t *dest, const std::size_t *dest_offsets, const uint8_t *src,
+    const std::size_t *src_offsets, const std::size_t *src_lengths,
+    std::size_t count, const MTBase64::IndexTable& table, bool padding) {
+
+    for (std::size_t i = 0; i < count; ++i)
+        if (src_lengths[i] > 0)
+            MTBase64::SWARIndexTableAccessor::EncodeBase64(
+                dest + dest_offsets[i], src + src_offsets[i], src_lengths[i],
+                table, padding);
+}
+
+/*Encodes whole lines group by group. A line of an odd number of groups ends
+with the group before it encoded once more, so every line except the short
+ones of 4 characters is encoded without the table implementation. The 8
+byte loads read up to 2 bytes past a line*/
+void MTBase64::SWARIndexTableAccessor::EncodeWrappedBase64(
+    uint8_t *dest, const uint8_t *src, std::size_t src_len,
+    const MTBase64::IndexTable& table, std::size_t line_length,
+    const uint8_t *separator, std::size_t separator_len, bool padding) {
+
+    const uint16_t *e_pairs = table.e_pairs.data();
+    const std::size_t d_line = line_length / 4 * 3;
+
+    auto encode_line = [&](uint8_t *out, const uint8_t *in) {
+        if (d_line < 6) {
+            MTBase64::IndexTableAccessor::EncodeBase64(out, in, d_line, table,
+                                                       false);
+            return;
+        }
+
+        std::size_t d_bc = 0;
+        for (; d_line - d_bc >= 6; d_bc += 6)
+            EncodeGroup(out + d_bc / 3 * 4, in + d_bc, e_pairs);
+        if (d_bc < d_line)
+            EncodeGroup(out + line_length - 8, in + d_line - 6, e_pairs);
+    };
+
+    MTBase64::EncodeLines(dest, src, src_len, line_length, separator,
+                          separator_len, padding, 2, encode_line,
+                          [&](uint8_t *out, const uint8_t *in,
+                              std::size_t len, bool pad) {
+                              MTBase64::SWARIndexTableAccessor::EncodeBase64(
+                                  out, in, len, table, pad);
+                          });
+}
@@ -4,19 +4,26 @@
  */
 
 #include "MTBase64.hpp"
+#include "Implementations/Implementations.hpp"
 
 #include <vector>
 #include <string>
 #include <memory>
+#include <new>
+#include <atomic>
 #include <algorithm>
 #include <type_traits>
 
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
-#include <cmath>
 
+#include <unistd.h>
+#include <sys/mman.h>
 
-#include "Implementations/default.cpp"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 
 const MTBase64::IndexTable MTBase64::kDefaultBase64 = MTBase64::IndexTable({
@@ -35,58 +42,749 @@ const MTBase64::IndexTable MTBase64::kUrlSafeBase64 = MTBase64::IndexTable({
 
 
 
+/*A kernel from `Implementations/` together with the check if the host CPU can
+run it. Kernels are listed from the fastest to the slowest one*/
+struct KernelEntry
+{
+  const char *name;
+  bool (*supported)();
+
+  const char *(*decode)(uint8_t *dest, const uint8_t *src,
+                        std::size_t src_len,
+                        const MTBase64::IndexTable& table, bool padding);
+  void (*encode)(uint8_t *dest, const uint8_t *src, std::size_t src_len,
+                 const MTBase64::IndexTable& table, bool padding);
+  std::size_t (*compact)(uint8_t *dest, const uint8_t *src,
+                         std::size_t src_len,
+                         const MTBase64::IgnoredBytes& ignored);
+  const char *(*transcode)(uint8_t *dest, const uint8_t *src,
+                           std::size_t src_len,
+                           const MTBase64::TranscodeMap& map);
+  std::size_t (*validate)(const uint8_t *src, std::size_t src_len,
+                          const MTBase64::IndexTable& table);
+  std::size_t (*count)(const uint8_t *src, std::size_t src_len,
+                       const MTBase64::IgnoredBytes& ignored);
+  void (*classify)(uint64_t *valid, const uint8_t *src, std::size_t src_len,
+                   const MTBase64::IndexTable& table);
+  const char *(*decode_constant_time)(uint8_t *dest, const uint8_t *src,
+                                      std::size_t src_len,
+                                      const MTBase64::IndexTable& table,
+                                      bool padding);
+  void (*encode_batch)(uint8_t *dest, const std::size_t *dest_offsets,
+                       const uint8_t *src, const std::size_t *src_offsets,
+                       const std::size_t *src_lengths, std::size_t count,
+                       const MTBase64::IndexTable& table, bool padding);
+  void (*encode_wrapped)(uint8_t *dest, const uint8_t *src,
+                         std::size_t src_len,
+                         const MTBase64::IndexTable& table,
+                         std::size_t line_length, const uint8_t *separator,
+                         std::size_t separator_len, bool padding);
+};
+
+static const KernelEntry kKernels[] = {
+  {"avx512vbmi",
+   MTBase64::VBMIIndexTableAccessor::Supported,
+   MTBase64::VBMIIndexTableAccessor::DecodeBase64,
+   MTBase64::VBMIIndexTableAccessor::EncodeBase64,
+   MTBase64::VBMIIndexTableAccessor::CompactBase64,
+   MTBase64::VBMIIndexTableAccessor::TranscodeBase64,
+   MTBase64::VBMIIndexTableAccessor::ValidateBase64,
+   MTBase64::VBMIIndexTableAccessor::CountBase64,
+   MTBase64::VBMIIndexTableAccessor::ClassifyBase64,
+   MTBase64::VBMIIndexTableAccessor::DecodeConstantTime,
+   MTBase64::VBMIIndexTableAccessor::EncodeBatchBase64,
+   MTBase64::VBMIIndexTableAccessor::EncodeWrappedBase64},
+  {"avx2",
+   MTBase64::AVX2IndexTableAccessor::Supported,
+   MTBase64::AVX2IndexTableAccessor::DecodeBase64,
+   MTBase64::AVX2IndexTableAccessor::EncodeBase64,
+   MTBase64::AVX2IndexTableAccessor::CompactBase64,
+   MTBase64::AVX2IndexTableAccessor::TranscodeBase64,
+   MTBase64::AVX2IndexTableAccessor::ValidateBase64,
+   MTBase64::AVX2IndexTableAccessor::CountBase64,
+   MTBase64::AVX2IndexTableAccessor::ClassifyBase64,
+   MTBase64::AVX2IndexTableAccessor::DecodeConstantTime,
+   MTBase64::AVX2IndexTableAccessor::EncodeBatchBase64,
+   MTBase64::AVX2IndexTableAccessor::EncodeWrappedBase64},
+  {"swar",
+   []() { return true; },
+   MTBase64::SWARIndexTableAccessor::DecodeBase64,
+   MTBase64::SWARIndexTableAccessor::EncodeBase64,
+   MTBase64::SWARIndexTableAccessor::CompactBase64,
+   MTBase64::SWARIndexTableAccessor::TranscodeBase64,
+   MTBase64::SWARIndexTableAccessor::ValidateBase64,
+   MTBase64::SWARIndexTableAccessor::CountBase64,
+   MTBase64::SWARIndexTableAccessor::ClassifyBase64,
+   MTBase64::SWARIndexTableAccessor::DecodeConstantTime,
+   MTBase64::SWARIndexTableAccessor::EncodeBatchBase64,
+   MTBase64::SWARIndexTableAccessor::EncodeWrappedBase64},
+  {"default",
+   []() { return true; },
+   MTBase64::IndexTableAccessor::DecodeBase64,
+   MTBase64::IndexTableAccessor::EncodeBase64,
+   MTBase64::IndexTableAccessor::CompactBase64,
+   MTBase64::IndexTableAccessor::TranscodeBase64,
+   MTBase64::IndexTableAccessor::ValidateBase64,
+   MTBase64::IndexTableAccessor::CountBase64,
+   MTBase64::IndexTableAccessor::ClassifyBase64,
+   MTBase64::IndexTableAccessor::DecodeConstantTime,
+   MTBase64::IndexTableAccessor::EncodeBatchBase64,
+   MTBase64::IndexTableAccessor::EncodeWrappedBase64},
+};
+
+/*Picks the kernel once, at the first call. A supported kernel named by the
+`MTBASE64_KERNEL` environment variable is preferred over the fastest one*/
+static const KernelEntry& GetKernel() {
+  static const KernelEntry& kernel = []() -> const KernelEntry& {
+    /*Might be called from static initializers before the CPU model is set*/
+    __builtin_cpu_init();
+
+    const char *pinned = std::getenv("MTBASE64_KERNEL");
+    if (pinned != nullptr)
+      for (const KernelEntry& entry : kKernels)
+        if (std::strcmp(entry.name, pinned) == 0 && entry.supported())
+          return entry;
+
+    for (const KernelEntry& entry : kKernels)
+      if (entry.supported())
+        return entry;
+
+    /*`default` is always supported*/
+    return kKernels[sizeof(kKernels) / sizeof(kKernels[0]) - 1];
+  }();
+
+  return kernel;
+}
+
+const char *MTBase64::GetKernelName() {
+  return GetKernel().name;
+}
+
+
+std::size_t MTBase64::GetStreamingThreshold() {
+  static const std::size_t threshold = []() -> std::size_t {
+    long size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (size <= 0)
+      size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+
+    return (size > 0) ? static_cast<std::size_t>(size) : 32 * 1024 * 1024;
+  }();
+
+  return threshold;
+}
+
+static bool UseStreaming(MTBase64::StoreMode store_mode, std::size_t out_len) {
+  if (store_mode == MTBase64::StoreMode::kAuto)
+    return out_len >= MTBase64::GetStreamingThreshold();
+
+  return store_mode == MTBase64::StoreMode::kStreaming;
+}
+
+
+/*Output bytes of one kernel call in the streaming mode. The kernels write into
+a staging buffer of this size which stays in the L1 cache and is then copied
+to the destination with streaming stores. That way every kernel streams its
+output, whatever the alignment of the destination is*/
+static const std::size_t kStagingSize = 12 * 1024;
+
+/*Only the unaligned head and tail of `dest` are written through the cache*/
+static void StreamCopy(uint8_t *dest, const uint8_t *src, std::size_t len) {
+#if defined(__SSE2__)
+  std::size_t head = (16 - (reinterpret_cast<uintptr_t>(dest) & 15)) & 15;
+  head = std::min(head, len);
+  std::memcpy(dest, src, head);
+
+  std::size_t i = head;
+  for (; len - i >= 16; i += 16)
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+
+  std::memcpy(dest + i, src + i, len - i);
+#else
+  std::memcpy(dest, src, len);
+#endif
+}
+
+/*Makes the streaming stores visible to other threads before returning*/
+static void StreamFence() {
+#if defined(__SSE2__)
+  _mm_sfence();
+#endif
+}
+
+static void StreamEncode(const KernelEntry& kernel, uint8_t *dest,
+                         const uint8_t *src, std::size_t src_len,
+                         const MTBase64::IndexTable& table, bool padding) {
+
+  alignas(64) uint8_t staging[kStagingSize];
+  /*Every chunk but the last one encodes to whole quads without padding*/
+  const std::size_t d_chunk = kStagingSize / 4 * 3;
+  std::size_t d_bc = 0, e_bc = 0;
+
+  while (src_len - d_bc > d_chunk) {
+    kernel.encode(staging, src + d_bc, d_chunk, table, padding);
+    StreamCopy(dest + e_bc, staging, kStagingSize);
+
+    d_bc += d_chunk;
+    e_bc += kStagingSize;
+  }
+
+  std::size_t last = src_len - d_bc;
+  kernel.encode(staging, src + d_bc, last, table, padding);
+  StreamCopy(dest + e_bc, staging, MTBase64::GetEncodedLength(last, padding));
+  StreamFence();
+}
+
+/*Number of padding characters ending the `len` characters of `src`*/
+static uint8_t TrailingPadding(const uint8_t *src, std::size_t len,
+                               const MTBase64::IndexTable& table) {
+  if (len < 2 || src[len - 1] != table.GetPadding())
+    return 0;
+
+  return 1 + (src[len - 2] == table.GetPadding());
+}
+
+/*Returns the error message of the kernel, `nullptr` on success*/
+static const char *StreamDecode(const KernelEntry& kernel, uint8_t *dest,
+                                const uint8_t *src, std::size_t src_len,
+                                const MTBase64::IndexTable& table,
+                                bool padding) {
+
+  /*Lets the kernel report a bad length before anything is written*/
+  if (padding ? !MTBase64::ValidPaddedEncodedLength(src_len)
+              : !MTBase64::ValidUnpaddedEncodedLength(src_len))
+    return kernel.decode(dest, src, src_len, table, padding);
+
+  alignas(64) uint8_t staging[kStagingSize];
+  const std::size_t e_chunk = kStagingSize / 3 * 4;
+  std::size_t e_bc = 0, d_bc = 0;
+
+  /*Padding is only allowed in the last chunk, so the others are decoded as
+  unpadded whole quads which rejects a padding character inside of them*/
+  while (src_len - e_bc > e_chunk) {
+    const char *error_message = kernel.decode(staging, src + e_bc, e_chunk,
+                                              table, false);
+    if (error_message != nullptr)
+      return error_message;
+
+    StreamCopy(dest + d_bc, staging, kStagingSize);
+
+    e_bc += e_chunk;
+    d_bc += kStagingSize;
+  }
+
+  std::size_t last = src_len - e_bc;
+  uint8_t padding_num = padding ? TrailingPadding(src, src_len, table) : 0;
+
+  const char *error_message = kernel.decode(staging, src + e_bc, last, table,
+                                            padding);
+  if (error_message != nullptr)
+    return error_message;
+
+  StreamCopy(dest + d_bc, staging,
+             MTBase64::TryGetDecodedLength(last, padding, padding_num).length);
+  StreamFence();
+  return nullptr;
+}
+
+static MTBase64::Status Succeeded(std::size_t length) {
+  return {nullptr, MTBase64::ErrorCodeTable::kNotValidBase64, length};
+}
+
+static MTBase64::Status Failed(MTBase64::ErrorCodeTable error_code,
+                               const char *error_message) {
+  return {error_message, error_code, 0};
+}
+
+/*Throws the error of a failed `Try` function from the throwing function
+layered on it, returns the length otherwise*/
+static std::size_t Checked(const MTBase64::Status& status,
+                           const char *function, std::size_t line_num) {
+  if (!status)
+    throw MTBase64::MTBase64Exception(__FILE__, function, line_num,
+                                      status.error_code, status.error_message);
+
+  return status.length;
+}
+
+/*Same for the error message of a decoding kernel*/
+static void Checked(const char *error_message, const char *function,
+                    std::size_t line_num) {
+  if (error_message != nullptr)
+    throw MTBase64::MTBase64Exception(
+      __FILE__, function, line_num,
+      MTBase64::ErrorCodeTable::kNotValidBase64, error_message);
+}
+
+
+MTBase64::Status MTBase64::TryDecodeMem(uint8_t *dest, const uint8_t *src,
+                                        std::size_t src_len,
+                                        const IndexTable& table, bool padding,
+                                        StoreMode store_mode) noexcept {
+
+  /*Counted before decoding since `dest` may be `src`, the kernel rejects
+  invalid lengths before `src` is read*/
+  uint8_t padding_num =
+    (padding && MTBase64::ValidPaddedEncodedLength(src_len)) ?
+    TrailingPadding(src, src_len, table) : 0;
+
+  const char *error_message =
+    UseStreaming(store_mode, src_len / 4 * 3) ?
+    StreamDecode(GetKernel(), dest, src, src_len, table, padding) :
+    GetKernel().decode(dest, src, src_len, table, padding);
+  if (error_message != nullptr)
+    return Failed(MTBase64::ErrorCodeTable::kNotValidBase64, error_message);
+
+  return MTBase64::TryGetDecodedLength(src_len, padding, padding_num);
+}
+
 void MTBase64::DecodeMem(uint8_t *dest, const uint8_t *src, std::size_t src_len,
-                         const IndexTable& table, bool padding) {
+                         const IndexTable& table, bool padding,
+                         StoreMode store_mode) {
 
-  IndexTableAccessor::DecodeBase64(dest, src, src_len, table, padding);
+  Checked(MTBase64::TryDecodeMem(dest, src, src_len, table, padding,
+                                 store_mode),
+          __FUNCTION__, __LINE__);
 }
 
 
+void MTBase64::DecodeConstantTimeMem(uint8_t *dest, const uint8_t *src,
+                                     std::size_t src_len,
+                                     const IndexTable& table, bool padding) {
+
+  Checked(GetKernel().decode_constant_time(dest, src, src_len, table, padding),
+          __FUNCTION__, __LINE__);
+}
+
+
+MTBase64::Status MTBase64::TryEncodeMem(uint8_t *dest, const uint8_t *src,
+                                        std::size_t src_len,
+                                        const IndexTable& table, bool padding,
+                                        StoreMode store_mode) noexcept {
+
+  /*The kernels write nothing for an empty input, it is only rejected here to
+  keep the contract of `EncodeMem`*/
+  if (src_len == 0)
+    return Failed(MTBase64::ErrorCodeTable::kIllegalFunctionCall,
+                  "input buffer length is 0.");
+
+  if (UseStreaming(store_mode, src_len / 3 * 4))
+    StreamEncode(GetKernel(), dest, src, src_len, table, padding);
+  else
+    GetKernel().encode(dest, src, src_len, table, padding);
+
+  return Succeeded(MTBase64::GetEncodedLength(src_len, padding));
+}
+
 void MTBase64::EncodeMem(uint8_t *dest, const uint8_t *src, std::size_t src_len,
-                         const IndexTable& table, bool padding) {
+                         const IndexTable& table, bool padding,
+                         StoreMode store_mode) {
 
-    IndexTableAccessor::EncodeBase64(dest, src, src_len, table, padding);
+  Checked(MTBase64::TryEncodeMem(dest, src, src_len, table, padding,
+                                 store_mode),
+          __FUNCTION__, __LINE__);
 }
 
-inline bool MTBase64::ValidPaddedEncodedLength(std::size_t encoded_length) {
-  return ((encoded_length % 4) == 0) && (encoded_length != 0);
+std::size_t MTBase64::DecodeInPlace(uint8_t *data, std::size_t len,
+                                    const IndexTable& table, bool padding) {
+
+  /*The lines of `data` were just read into the caches, so streaming stores
+  would not save anything*/
+  return Checked(MTBase64::TryDecodeMem(data, data, len, table, padding,
+                                        StoreMode::kCached),
+                 __FUNCTION__, __LINE__);
 }
 
-inline bool MTBase64::ValidUnpaddedEncodedLength(std::size_t encoded_length) {
-  return (encoded_length % 4) != 1 && (encoded_length != 0);
+std::size_t MTBase64::EncodeInPlace(uint8_t *buf, std::size_t data_len,
+                                    std::size_t capacity,
+                                    const IndexTable& table, bool padding) {
+
+  std::size_t encoded_length = MTBase64::GetEncodedLength(data_len, padding);
+  if (encoded_length > capacity)
+    throw MTBase64::MTBase64Exception(
+      __FILE__, __FUNCTION__, __LINE__,
+      MTBase64::ErrorCodeTable::kIllegalFunctionCall,
+      "Buffer capacity is too small for the encoded data.");
+
+  if (data_len == 0)
+    return 0;
+
+  /*The block [start, end) is encoded to `start / 3 * 4`, which is not before
+  `end` if `start` is at least 3/4 of `end`. The output then overlaps neither
+  the block itself nor the bytes before it. Blocks shrink with what is left,
+  only the first one holds the last incomplete group*/
+  const KernelEntry& kernel = GetKernel();
+  const std::size_t kStagedLength = kStagingSize / 4 * 3;
+  std::size_t end = data_len;
+
+  while (end > kStagedLength) {
+    std::size_t start = (end - end / 4 + 2) / 3 * 3;
+    kernel.encode(buf + start / 3 * 4, buf + start, end - start, table,
+                  padding);
+    end = start;
+  }
+
+  /*What is left is too short for the blocks and is staged*/
+  alignas(64) uint8_t staging[kStagingSize];
+  kernel.encode(staging, buf, end, table, padding);
+  std::memcpy(buf, staging, MTBase64::GetEncodedLength(end, padding));
+
+  return encoded_length;
 }
 
+std::size_t MTBase64::EncodeInto(uint8_t *dest, std::size_t dest_capacity,
+                                 const uint8_t *src, std::size_t src_len,
+                                 const IndexTable& table, bool padding,
+                                 StoreMode store_mode) {
 
-/*Cannot calculate real length without knowing if the last 4 bytes consists of
-padding or encoded data. Real length is being calculated by
-(3 * (encoded_length / 4)) - num_of_padding_chars*/
-std::size_t MTBase64::GetDecodedLength(std::size_t encoded_length,
-                                       bool padding,
-                                       uint8_t padding_num) {
+  std::size_t encoded_length = MTBase64::GetEncodedLength(src_len, padding);
+  if (encoded_length > dest_capacity)
+    throw MTBase64::MTBase64Exception(
+      __FILE__, __FUNCTION__, __LINE__,
+      MTBase64::ErrorCodeTable::kIllegalFunctionCall,
+      "Destination is too small for the encoded data.");
 
-  if (!padding && padding_num > 0)
+  MTBase64::EncodeMem(dest, src, src_len, table, padding, store_mode);
+  return encoded_length;
+}
+
+std::size_t MTBase64::DecodeInto(uint8_t *dest, std::size_t dest_capacity,
+                                 const uint8_t *src, std::size_t src_len,
+                                 const IndexTable& table, bool padding,
+                                 StoreMode store_mode) {
+
+  uint8_t padding_num = padding ? TrailingPadding(src, src_len, table) : 0;
+  std::size_t decoded_length = MTBase64::GetDecodedLength(src_len, padding,
+                                                          padding_num);
+  if (decoded_length > dest_capacity)
     throw MTBase64::MTBase64Exception(
       __FILE__, __FUNCTION__, __LINE__,
       MTBase64::ErrorCodeTable::kIllegalFunctionCall,
-      "`padding_num` is set when padding is not being used.");
+      "Destination is too small for the decoded data.");
 
-  if (padding && padding_num > 2)
+  MTBase64::DecodeMem(dest, src, src_len, table, padding, store_mode);
+  return decoded_length;
+}
+
+/*The ignored bytes may be neither characters nor the padding of `table`*/
+static void CheckIgnoredBytes(const MTBase64::IgnoredBytes& ignored_bytes,
+                              const MTBase64::IndexTable& table,
+                              bool padding) {
+
+  for (uint8_t index = 0; index < 64; ++index)
+    if (ignored_bytes.map[table.Lookup(index)] != 0)
+      throw MTBase64::MTBase64Exception(
+        __FILE__, __FUNCTION__, __LINE__,
+        MTBase64::ErrorCodeTable::kIllegalFunctionCall,
+        "An ignored byte is a character of the given table.");
+
+  if (padding && ignored_bytes.map[table.GetPadding()] != 0)
     throw MTBase64::MTBase64Exception(
       __FILE__, __FUNCTION__, __LINE__,
       MTBase64::ErrorCodeTable::kIllegalFunctionCall,
-      "Not valid amount of padding is being specified");
+      "An ignored byte is the padding of the given table.");
+}
 
-  if (padding && !MTBase64::ValidPaddedEncodedLength(encoded_length))
+std::size_t MTBase64::DecodeSkippingMem(uint8_t *dest, const uint8_t *src,
+                                        std::size_t src_len,
+                                        const IndexTable& table,
+                                        bool padding,
+                                        const std::string& ignored) {
+
+  const MTBase64::IgnoredBytes ignored_bytes(ignored);
+  CheckIgnoredBytes(ignored_bytes, table, padding);
+
+  const KernelEntry& kernel = GetKernel();
+  /*The kernel compacts the input into the L1 resident staging buffer, from
+  which the whole quads are decoded straight away*/
+  alignas(64) uint8_t staging[kStagingSize];
+  std::size_t kept = 0, e_bc = 0, d_bc = 0;
+
+  while (e_bc < src_len) {
+    std::size_t chunk = std::min(src_len - e_bc, kStagingSize - kept);
+    kept += kernel.compact(staging + kept, src + e_bc, chunk, ignored_bytes);
+    e_bc += chunk;
+
+    /*The last quad is held back since it may be padded and only followed by
+    ignored bytes. The quads before it are decoded as unpadded ones, which
+    rejects padding inside of the input*/
+    if (kept < 8)
+      continue;
+
+    std::size_t quads = (kept - 4) / 4 * 4;
+    Checked(kernel.decode(dest + d_bc, staging, quads, table, false),
+            __FUNCTION__, __LINE__);
+    d_bc += quads / 4 * 3;
+
+    std::memmove(staging, staging + quads, kept - quads);
+    kept -= quads;
+  }
+
+  uint8_t padding_num = padding ? TrailingPadding(staging, kept, table) : 0;
+  Checked(kernel.decode(dest + d_bc, staging, kept, table, padding),
+          __FUNCTION__, __LINE__);
+
+  return d_bc + MTBase64::GetDecodedLength(kept, padding, padding_num);
+}
+
+/*Counts the characters that are not ignored and looks for padding among the
+last two of them*/
+std::size_t MTBase64::GetSkippingDecodedLength(const uint8_t *src,
+                                               std::size_t src_len,
+                                               const IndexTable& table,
+                                               bool padding,
+                                               const std::string& ignored) {
+
+  const MTBase64::IgnoredBytes ignored_bytes(ignored);
+  CheckIgnoredBytes(ignored_bytes, table, padding);
+
+  std::size_t chars = GetKernel().count(src, src_len, ignored_bytes);
+
+  uint8_t padding_num = 0;
+  std::size_t end = src_len;
+  while (padding && padding_num < 2) {
+    while (end > 0 && ignored_bytes.map[src[end - 1]] != 0)
+      --end;
+
+    if (end == 0 || src[end - 1] != table.GetPadding())
+      break;
+
+    --end;
+    ++padding_num;
+  }
+
+  return MTBase64::GetDecodedLength(chars, padding, padding_num);
+}
+
+MTBase64::Status MTBase64::TryTranscode(uint8_t *dest, const uint8_t *src,
+                                        std::size_t src_len,
+                                        const IndexTable& from_table,
+                                        const IndexTable& to_table,
+                                        bool from_padding,
+                                        bool to_padding) noexcept {
+
+  if (from_padding && !MTBase64::ValidPaddedEncodedLength(src_len))
+    return Failed(MTBase64::ErrorCodeTable::kNotValidBase64,
+                  MTBase64::kPaddedLengthError);
+
+  if (!from_padding && !MTBase64::ValidUnpaddedEncodedLength(src_len))
+    return Failed(MTBase64::ErrorCodeTable::kNotValidBase64,
+                  MTBase64::kUnpaddedLengthError);
+
+  /*Padding anywhere else is not part of `from_table` and is rejected by the
+  kernel together with every other invalid character*/
+  std::size_t chars = src_len;
+  if (from_padding)
+    chars -= TrailingPadding(src, src_len, from_table);
+
+  const MTBase64::TranscodeMap map(from_table, to_table);
+  const char *error_message = GetKernel().transcode(dest, src, chars, map);
+  if (error_message != nullptr)
+    return Failed(MTBase64::ErrorCodeTable::kNotValidBase64, error_message);
+
+  if (!to_padding)
+    return Succeeded(chars);
+
+  std::size_t padding_num = (4 - (chars % 4)) % 4;
+  std::memset(dest + chars, to_table.GetPadding(), padding_num);
+  return Succeeded(chars + padding_num);
+}
+
+std::size_t MTBase64::Transcode(uint8_t *dest, const uint8_t *src,
+                                std::size_t src_len,
+                                const IndexTable& from_table,
+                                const IndexTable& to_table,
+                                bool from_padding, bool to_padding) {
+
+  return Checked(MTBase64::TryTranscode(dest, src, src_len, from_table,
+                                        to_table, from_padding, to_padding),
+                 __FUNCTION__, __LINE__);
+}
+
+MTBase64::ValidationResult MTBase64::Validate(const uint8_t *src,
+                                              std::size_t src_len,
+                                              const IndexTable& table,
+                                              bool padding) {
+
+  if (padding ? !MTBase64::ValidPaddedEncodedLength(src_len)
+              : !MTBase64::ValidUnpaddedEncodedLength(src_len))
+    return {MTBase64::ValidationError::kInvalidLength, src_len};
+
+  std::size_t chars = src_len;
+  if (padding)
+    chars -= TrailingPadding(src, src_len, table);
+
+  std::size_t offset = GetKernel().validate(src, chars, table);
+  if (offset == chars)
+    return {MTBase64::ValidationError::kNone, src_len};
+
+  if (src[offset] == table.GetPadding())
+    return {MTBase64::ValidationError::kMisplacedPadding, offset};
+
+  return {MTBase64::ValidationError::kInvalidCharacter, offset};
+}
+
+/*Bit `i` of the result is set if the bits `i` to `i + length - 1` of `bits`
+are all set, for a `length` of 1 to 64*/
+static uint64_t RunStarts(unsigned __int128 bits, std::size_t length) {
+  std::size_t covered = 1;
+  for (; covered * 2 <= length; covered *= 2)
+    bits &= bits >> covered;
+
+  if (covered < length)
+    bits &= bits >> (length - covered);
+
+  return static_cast<uint64_t>(bits);
+}
+
+std::vector<MTBase64::Base64Run> MTBase64::FindBase64Runs(
+  const uint8_t *src, std::size_t src_len, const IndexTable& table,
+  std::size_t min_length, bool padding) {
+
+  if (min_length == 0)
     throw MTBase64::MTBase64Exception(
       __FILE__, __FUNCTION__, __LINE__,
-      MTBase64::ErrorCodeTable::kNotValidBase64,
-      "Not valid base64 encoding length when padding is being used.");
+      MTBase64::ErrorCodeTable::kIllegalFunctionCall,
+      "The minimal run length has to be positive.");
 
-  if (!padding && !MTBase64::ValidUnpaddedEncodedLength(encoded_length))
+  std::vector<MTBase64::Base64Run> runs;
+  std::size_t start = 0;
+  bool in_run = false;
+
+  auto close_run = [&](std::size_t end) {
+    in_run = false;
+    if (end - start < min_length)
+      return;
+
+    std::size_t padding_num = 0;
+    while (padding && padding_num < 2 && end + padding_num < src_len &&
+           src[end + padding_num] == table.GetPadding())
+      ++padding_num;
+
+    runs.push_back({start, end - start + padding_num});
+  };
+
+  const KernelEntry& kernel = GetKernel();
+  /*One bit per byte of a block of the input, which keeps the masks in L1*/
+  uint64_t valid[kStagingSize / 64];
+
+  for (std::size_t e_bc = 0; e_bc < src_len; e_bc += kStagingSize) {
+    std::size_t chunk = std::min(src_len - e_bc, kStagingSize);
+    kernel.classify(valid, src + e_bc, chunk, table);
+
+    const std::size_t words = (chunk + 63) / 64;
+    for (std::size_t word = 0; word < words; ++word) {
+      /*Runs can only start where `min_length` characters follow, which skips
+      the short words of plain text. Past the block the characters are not
+      classified yet and every start is assumed, `close_run` checks it*/
+      uint64_t next = (word + 1 < words) ? valid[word + 1]
+                    : (e_bc + chunk < src_len) ? ~uint64_t{0} : 0;
+      uint64_t starts = RunStarts(
+        valid[word] | static_cast<unsigned __int128>(next) << 64,
+        std::min<std::size_t>(min_length, 64));
+
+      /*Jumps from one transition to the next, so long runs and long stretches
+      of text cost one `ctz` each*/
+      unsigned bit = 0;
+      while (bit < 64) {
+        uint64_t rest = (in_run ? ~valid[word] : starts) >> bit;
+        if (rest == 0)
+          break;
+
+        bit += __builtin_ctzll(rest);
+        if (in_run) {
+          close_run(e_bc + word * 64 + bit);
+        } else {
+          start = e_bc + word * 64 + bit;
+          in_run = true;
+        }
+      }
+    }
+  }
+
+  if (in_run)
+    close_run(src_len);
+
+  return runs;
+}
+
+std::size_t MTBase64::EncodeBatchMem(uint8_t *dest, std::size_t *dest_offsets,
+                                     const uint8_t *src,
+                                     const std::size_t *src_offsets,
+                                     const std::size_t *src_lengths,
+                                     std::size_t count, const IndexTable& table,
+                                     bool padding) {
+
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    dest_offsets[i] = total;
+    total += MTBase64::GetEncodedLength(src_lengths[i], padding);
+  }
+
+  GetKernel().encode_batch(dest, dest_offsets, src, src_offsets, src_lengths,
+                           count, table, padding);
+  return total;
+}
+
+std::size_t MTBase64::GetBatchEncodedLength(const std::size_t *src_lengths,
+                                            std::size_t count, bool padding) {
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < count; ++i)
+    total += MTBase64::GetEncodedLength(src_lengths[i], padding);
+
+  return total;
+}
+
+void MTBase64::EncodeWrappedMem(uint8_t *dest, const uint8_t *src,
+                                std::size_t src_len, const IndexTable& table,
+                                std::size_t line_length,
+                                const std::string& separator, bool padding) {
+
+  if (line_length == 0 || (line_length % 4) != 0)
     throw MTBase64::MTBase64Exception(
       __FILE__, __FUNCTION__, __LINE__,
-      MTBase64::ErrorCodeTable::kNotValidBase64,
-      "Not valid base64 encoding length when padding is not being used.");
+      MTBase64::ErrorCodeTable::kIllegalFunctionCall,
+      "`line_length` is not a positive multiple of 4.");
+
+  if (src_len == 0)
+    return;
+
+  GetKernel().encode_wrapped(dest, src, src_len, table, line_length,
+                             reinterpret_cast<const uint8_t*>(separator.data()),
+                             separator.size(), padding);
+}
+
+bool MTBase64::ValidPaddedEncodedLength(std::size_t encoded_length) {
+  return ((encoded_length % 4) == 0) && (encoded_length != 0);
+}
+
+bool MTBase64::ValidUnpaddedEncodedLength(std::size_t encoded_length) {
+  return (encoded_length % 4) != 1 && (encoded_length != 0);
+}
+
+
+/*Cannot calculate real length without knowing if the last 4 bytes consists of
+padding or encoded data. Real length is being calculated by
+(3 * (encoded_length / 4)) - num_of_padding_chars*/
+MTBase64::Status MTBase64::TryGetDecodedLength(std::size_t encoded_length,
+                                               bool padding,
+                                               uint8_t padding_num) noexcept {
+
+  if (!padding && padding_num > 0)
+    return Failed(MTBase64::ErrorCodeTable::kIllegalFunctionCall,
+                  "`padding_num` is set when padding is not being used.");
+
+  if (padding && padding_num > 2)
+    return Failed(MTBase64::ErrorCodeTable::kIllegalFunctionCall,
+                  "Not valid amount of padding is being specified");
+
+  if (padding && !MTBase64::ValidPaddedEncodedLength(encoded_length))
+    return Failed(MTBase64::ErrorCodeTable::kNotValidBase64,
+                  MTBase64::kPaddedLengthError);
+
+  if (!padding && !MTBase64::ValidUnpaddedEncodedLength(encoded_length))
+    return Failed(MTBase64::ErrorCodeTable::kNotValidBase64,
+                  MTBase64::kUnpaddedLengthError);
 
 
   /*`fantom_padding_num` is used for base64 encoded data without added padding.
@@ -99,7 +797,38 @@ std::size_t MTBase64::GetDecodedLength(std::size_t encoded_length,
   padding_num = (!padding) ? fantom_padding_num : padding_num;
 
 
-  return 3 * ((encoded_length + fantom_padding_num) / 4) - padding_num;
+  return Succeeded(3 * ((encoded_length + fantom_padding_num) / 4) -
+                   padding_num);
+}
+
+std::size_t MTBase64::GetDecodedLength(std::size_t encoded_length,
+                                       bool padding,
+                                       uint8_t padding_num) {
+
+  return Checked(MTBase64::TryGetDecodedLength(encoded_length, padding,
+                                               padding_num),
+                 __FUNCTION__, __LINE__);
+}
+
+/*Every line but the last one is followed by a separator*/
+std::size_t MTBase64::GetWrappedEncodedLength(std::size_t decoded_length,
+                                              bool padding,
+                                              std::size_t line_length,
+                                              std::size_t separator_length) {
+
+  if (line_length == 0 || (line_length % 4) != 0)
+    throw MTBase64::MTBase64Exception(
+      __FILE__, __FUNCTION__, __LINE__,
+      MTBase64::ErrorCodeTable::kIllegalFunctionCall,
+      "`line_length` is not a positive multiple of 4.");
+
+  std::size_t encoded_length = MTBase64::GetEncodedLength(decoded_length,
+                                                          padding);
+  if (encoded_length == 0)
+    return 0;
+
+  std::size_t lines = (encoded_length + line_length - 1) / line_length;
+  return encoded_length + (lines - 1) * separator_length;
 }
 
 /*Splits the length of uncoded data to whole base64 chunks of 3 characters and
@@ -109,9 +838,9 @@ std::size_t MTBase64::GetEncodedLength(std::size_t decoded_length,
                                        bool padding) {
 
   if (padding)
-    return ceil((double)decoded_length / 3) * 4;
+    return (decoded_length + 2) / 3 * 4;
 
-  return ceil((double)decoded_length * 4 / 3);
+  return (decoded_length * 4 + 2) / 3;
 }
 
 
@@ -124,6 +853,8 @@ MTBase64::IndexTable::IndexTable(const std::array<uint8_t, 64>&  linear_table,
   std::fill(this->d1.begin(), this->d1.end(), MTBASE64__BADCHAR);
   std::fill(this->d2.begin(), this->d2.end(), MTBASE64__BADCHAR);
   std::fill(this->d3.begin(), this->d3.end(), MTBASE64__BADCHAR);
+  std::fill(this->d_perm.begin(), this->d_perm.end(), 0x80);
+  std::fill(this->d_valid.begin(), this->d_valid.end(), 0);
 
 
   for (int i = 0; i < 64; ++i) {
@@ -150,6 +881,9 @@ MTBase64::IndexTable::IndexTable(const std::array<uint8_t, 64>&  linear_table,
     this->e2.at(i+2*64) = linear_table.at(i);
     this->e2.at(i+3*64) = linear_table.at(i);
 
+    this->e_rows.at(i >> 4).at((i & 0x0F) + 0)  = linear_table.at(i);
+    this->e_rows.at(i >> 4).at((i & 0x0F) + 16) = linear_table.at(i);
+
     /*Most effective way to check for multiple occurences in the index table?
     Checks if the empty slot with a padding value was already set before*/
     if(this->d.at(linear_table.at(i)) != padding)
@@ -165,6 +899,69 @@ MTBase64::IndexTable::IndexTable(const std::array<uint8_t, 64>&  linear_table,
     this->d1.at(linear_table.at(i)) = ((i & 0x30) >> 4) | ((i & 0x0F) << 12);
     this->d2.at(linear_table.at(i)) = ((i & 0x03) << 22) | ((i & 0x3C) << 6);
     this->d3.at(linear_table.at(i)) = i << 16;
+    this->d_perm.at(linear_table.at(i)) = i;
+    this->d_valid.at(linear_table.at(i) >> 3) |= 1 << (linear_table.at(i) & 7);
+  }
+
+  for (int i = 0; i < 4096; ++i)
+    this->e_pairs.at(i) = linear_table.at(i >> 6) |
+                          (linear_table.at(i & 0x3F) << 8);
+
+  /*Both built-in tables start with `A-Za-z0-9`, which lets the SIMD encoders
+  map an index to its character by adding a shift chosen from the index range.
+  Only the shifts of the last two characters depend on the table*/
+  static const char kRFCPrefix[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                   "abcdefghijklmnopqrstuvwxyz0123456789";
+  this->rfc_prefix_ = std::equal(linear_table.begin(),
+                                 linear_table.begin() + 62,
+                                 kRFCPrefix);
+
+  this->e_shift = {
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    static_cast<int8_t>(linear_table.at(62) - 62),
+    static_cast<int8_t>(linear_table.at(63) - 63),
+    'A', 0, 0};
+
+  /*Groups the 16 rows of 16 characters (indexed by the upper nibble) by the
+  set of lower nibbles that are valid in them. Every class gets a bit in `d_hi`
+  and `d_lo` marks the lower nibbles that are not valid in each class*/
+  std::array<uint16_t, 16> rows = {};
+  for (int i = 0; i < 64; ++i)
+    rows.at(linear_table.at(i) >> 4) |= 1 << (linear_table.at(i) & 0x0F);
+
+  std::vector<uint16_t> classes;
+  std::fill(this->d_lo.begin(), this->d_lo.end(), 0);
+  for (int h = 0; h < 16; ++h) {
+    auto it = std::find(classes.begin(), classes.end(), rows.at(h));
+    if (it == classes.end())
+      it = classes.insert(classes.end(), rows.at(h));
+
+    this->d_hi.at(h) = 1 << ((it - classes.begin()) & 0x07);
+  }
+
+  this->nibble_check_ = classes.size() <= 8;
+  for (std::size_t c = 0; c < classes.size() && this->nibble_check_; ++c)
+    for (int l = 0; l < 16; ++l)
+      if (!((classes.at(c) >> l) & 1))
+        this->d_lo.at(l) |= 1 << c;
+
+  /*Most tables are made of a few runs like `A-Z`, which can be decoded with a
+  range check and an addition per run*/
+  this->d_plan_size_ = 0;
+  for (int i = 0; i < 64; ++i) {
+    if (i > 0 && linear_table.at(i) == linear_table.at(i-1) + 1) {
+      ++this->d_plan.at(this->d_plan_size_ - 1).length;
+      continue;
+    }
+
+    if (this->d_plan_size_ == this->d_plan.size()) {
+      this->d_plan_size_ = 0;
+      break;
+    }
+
+    this->d_plan.at(this->d_plan_size_++) = {linear_table.at(i), 1,
+                                             static_cast<uint8_t>(i)};
   }
 }
 
@@ -185,6 +982,129 @@ uint8_t MTBase64::IndexTable::GetPadding() const { return this->padding_; }
 
 
 
+static std::atomic<std::size_t> huge_page_threshold{4 * 1024 * 1024};
+
+std::size_t MTBase64::GetHugePageThreshold() {
+  return huge_page_threshold.load(std::memory_order_relaxed);
+}
+
+void MTBase64::SetHugePageThreshold(std::size_t threshold) {
+  huge_page_threshold.store(threshold, std::memory_order_relaxed);
+}
+
+/*Transparent huge pages are only used for whole 2MiB pages, so the mapping
+is made 2MiB larger than needed and trimmed to a 2MiB boundary*/
+static std::shared_ptr<uint8_t> MapHugePages(std::size_t size) {
+  const std::size_t kHugePage = 2 * 1024 * 1024;
+  const std::size_t length = (size + kHugePage - 1) / kHugePage * kHugePage;
+
+  void *mapping = mmap(nullptr, length + kHugePage, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED)
+    throw std::bad_alloc();
+
+  uintptr_t address = reinterpret_cast<uintptr_t>(mapping);
+  uintptr_t aligned = (address + kHugePage - 1) / kHugePage * kHugePage;
+
+  if (aligned > address)
+    munmap(mapping, aligned - address);
+  munmap(reinterpret_cast<void*>(aligned + length),
+         address + kHugePage - aligned);
+
+#if defined(MADV_HUGEPAGE)
+  /*Only advice, kernels without transparent huge pages use small ones*/
+  madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE);
+#endif
+
+  return std::shared_ptr<uint8_t>(
+    reinterpret_cast<uint8_t*>(aligned),
+    [length](uint8_t *data) { munmap(data, length); });
+}
+
+MTBase64::Buffer::Buffer() : data_(nullptr), size_(0) {}
+
+MTBase64::Buffer::Buffer(std::shared_ptr<uint8_t> storage, uint8_t *data,
+                         std::size_t size)
+  : storage_(std::move(storage)), data_(data), size_(size) {}
+
+MTBase64::Buffer::Buffer(std::size_t size) : data_(nullptr), size_(size) {
+  if (size == 0)
+    return;
+
+  if (size >= MTBase64::GetHugePageThreshold()) {
+    this->storage_ = MapHugePages(size);
+  } else {
+    void *data = std::aligned_alloc(64, (size + 63) / 64 * 64);
+    if (data == nullptr)
+      throw std::bad_alloc();
+
+    this->storage_ = std::shared_ptr<uint8_t>(static_cast<uint8_t*>(data),
+                                              std::free);
+  }
+
+  this->data_ = this->storage_.get();
+}
+
+MTBase64::Buffer::Buffer(Buffer&& other) noexcept
+  : storage_(std::move(other.storage_)), data_(other.data_),
+    size_(other.size_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+}
+
+MTBase64::Buffer& MTBase64::Buffer::operator=(Buffer&& other) noexcept {
+  /*Assigning a buffer to itself has to leave it as it is*/
+  if (this == &other)
+    return *this;
+
+  this->storage_ = std::move(other.storage_);
+  this->data_ = other.data_;
+  this->size_ = other.size_;
+
+  other.data_ = nullptr;
+  other.size_ = 0;
+  return *this;
+}
+
+MTBase64::Buffer MTBase64::Buffer::Slice(std::size_t offset,
+                                         std::size_t length) {
+  if (offset > this->size_ || length > this->size_ - offset)
+    throw MTBase64::MTBase64Exception(
+      __FILE__, __FUNCTION__, __LINE__,
+      MTBase64::ErrorCodeTable::kIllegalFunctionCall,
+      "Slice is not inside of the buffer.");
+
+  return Buffer(this->storage_, this->data_ + offset, length);
+}
+
+std::shared_ptr<uint8_t> MTBase64::Buffer::Release() {
+  std::shared_ptr<uint8_t> released(this->storage_, this->data_);
+
+  this->storage_.reset();
+  this->data_ = nullptr;
+  this->size_ = 0;
+  return released;
+}
+
+MTBase64::Buffer MTBase64::EncodeBuffer(const uint8_t *src,
+                                        std::size_t src_len,
+                                        const IndexTable& table, bool padding) {
+  MTBase64::Buffer buffer(MTBase64::GetEncodedLength(src_len, padding));
+  MTBase64::EncodeMem(buffer.data(), src, src_len, table, padding);
+  return buffer;
+}
+
+MTBase64::Buffer MTBase64::DecodeBuffer(const uint8_t *src,
+                                        std::size_t src_len,
+                                        const IndexTable& table, bool padding) {
+  uint8_t padding_num = padding ? TrailingPadding(src, src_len, table) : 0;
+  MTBase64::Buffer buffer(MTBase64::GetDecodedLength(src_len, padding,
+                                                     padding_num));
+  MTBase64::DecodeMem(buffer.data(), src, src_len, table, padding);
+  return buffer;
+}
+
+
 MTBase64::MTBase64Exception::MTBase64Exception(const char *file,
                                                const char *function,
                                                std::size_t line_num,
@@ -9,8 +9,15 @@
 #include <array>
 #include <vector>
 
+#include <utility>
+#include <type_traits>
+
 #include <cstdint>
 
+#if __cplusplus >= 202002L && __has_include(<span>)
+	#include <span>
+#endif
+
 #include <cxxabi.h>
 #include <typeinfo>
 
@@ -30,6 +37,56 @@ enum class ErrorCodeTable
   kIllegalFunctionCall        /*For passing not valid parameters*/
 };
 
+/*How `EncodeMem` and `DecodeMem` write their output. Streaming stores bypass
+the caches, which keeps the working set of the caller cached and saves the
+read for ownership of every destination line, but makes reading the output
+back right away slower*/
+enum class StoreMode
+{
+  kAuto,                      /*Streaming from `GetStreamingThreshold` bytes*/
+  kCached,                    /*Always regular stores*/
+  kStreaming                  /*Always streaming stores*/
+};
+
+/*Reason of the first violation found by `Validate`*/
+enum class ValidationError
+{
+  kNone,                      /*Valid base64*/
+  kInvalidLength,             /*Not a valid length for the used padding*/
+  kInvalidCharacter,          /*A byte that is not in the table*/
+  kMisplacedPadding           /*Padding before the end or too much of it*/
+};
+
+struct ValidationResult
+{
+  ValidationError error;
+  /*Offset of the violating byte, the length of the input for `kNone` and
+  `kInvalidLength`*/
+  std::size_t offset;
+
+  explicit operator bool() const { return error == ValidationError::kNone; }
+};
+
+/*Result of the `Try` functions, which report the errors the functions they
+are named after throw as `MTBase64Exception`. They never throw, so they can
+be called from code built without exceptions and an invalid input costs no
+more than a valid one*/
+struct Status
+{
+  const char *error_message;  /*`nullptr` on success*/
+  ErrorCodeTable error_code;  /*Only set on failure*/
+  std::size_t length;         /*Number of written bytes on success*/
+
+  explicit operator bool() const noexcept { return error_message == nullptr; }
+};
+
+/*Run of characters found by `FindBase64Runs`*/
+struct Base64Run
+{
+  std::size_t offset;
+  std::size_t length;
+};
+
 class MTBase64Exception : public std::exception
 {
 private:
@@ -62,11 +119,52 @@ private:
   std::array<uint32_t, 256> e0;
   std::array<uint32_t, 256> e1;
   std::array<uint32_t, 256> e2;
-  
+
+  /*The table split into four rows of 16 characters, each row repeated twice to
+  fill a 32 byte `pshufb` lookup vector*/
+  std::array<std::array<uint8_t, 32>, 4> e_rows;
+
+  /*Two characters per 12 bit index for the SWAR encoder, the first character
+  in the lower byte*/
+  std::array<uint16_t, 4096> e_pairs;
+
 
   std::array<uint8_t, 64> e;
   std::array<uint8_t, 256> d;
 
+  /*ASCII shift lookup used by the SIMD encoders for tables starting with the
+  RFC 4648 `A-Za-z0-9` characters. Only the last two entries vary per table*/
+  std::array<int8_t, 16> e_shift;
+  bool rfc_prefix_;
+
+  /*Nibble lookups used by the SIMD decoders to validate characters. A byte is
+  not in the table if `d_lo[byte & 0x0F] & d_hi[byte >> 4]` is non zero. Only
+  tables whose rows of 16 characters fall into 8 or less classes are covered*/
+  std::array<uint8_t, 16> d_lo;
+  std::array<uint8_t, 16> d_hi;
+  bool nibble_check_;
+
+  /*Decode plan: the table described as runs of consecutive characters mapping
+  to consecutive indices. Only set for tables with 8 or less runs, otherwise
+  `d_plan_size_` is 0*/
+  struct DecodeRange
+  {
+    uint8_t start;
+    uint8_t length;
+    uint8_t index;
+  };
+
+  std::array<DecodeRange, 8> d_plan;
+  uint8_t d_plan_size_;
+
+  /*Reverse lookup with the top bit set for characters outside of the table.
+  Loaded as four 64 byte permutation vectors by the AVX-512 VBMI decoder*/
+  std::array<uint8_t, 256> d_perm;
+
+  /*Bit `byte & 7` of `d_valid[byte >> 3]` is set for the characters of the
+  table, tested with `pshufb` lookups by the AVX2 validation*/
+  std::array<uint8_t, 32> d_valid;
+
   uint8_t padding_;
 
 public:
@@ -79,9 +177,64 @@ public:
   uint8_t GetPadding() const;
 
   friend struct IndexTableAccessor;
+  friend struct SWARIndexTableAccessor;
+  friend struct AVX2IndexTableAccessor;
+  friend struct VBMIIndexTableAccessor;
 };
 
+/*Bytes owned by the results of `EncodeBuffer` and `DecodeBuffer`. The start
+of the allocation is aligned to 64 bytes. Allocations of
+`GetHugePageThreshold` bytes or more are mapped on their own and advised to
+be backed by transparent huge pages, which takes one page fault per 2MiB
+instead of one per 4KiB. Buffers can only be moved. Slices share the
+allocation, which is freed with the last buffer referring to it*/
+class Buffer
+{
+private:
+  std::shared_ptr<uint8_t> storage_;
+  uint8_t *data_;
+  std::size_t size_;
+
+  Buffer(std::shared_ptr<uint8_t> storage, uint8_t *data, std::size_t size);
+
+public:
+  Buffer();
+  explicit Buffer(std::size_t size);
+
+  Buffer(Buffer&& other) noexcept;
+  Buffer& operator=(Buffer&& other) noexcept;
+  Buffer(const Buffer&) = delete;
+  Buffer& operator=(const Buffer&) = delete;
+
+  uint8_t *data() { return this->data_; }
+  const uint8_t *data() const { return this->data_; }
+  std::size_t size() const { return this->size_; }
+  bool empty() const { return this->size_ == 0; }
+
+  uint8_t *begin() { return this->data_; }
+  uint8_t *end() { return this->data_ + this->size_; }
+  const uint8_t *begin() const { return this->data_; }
+  const uint8_t *end() const { return this->data_ + this->size_; }
+
+  /*`length` bytes from `offset` on, sharing the allocation of this buffer.
+  The slice can write to them, so only a mutable buffer can be sliced.
+  Throws with `kIllegalFunctionCall` if they are not inside of it*/
+  Buffer Slice(std::size_t offset, std::size_t length);
+
+  /*Hands the bytes over to the caller and leaves this buffer empty. The
+  returned pointer frees the allocation once it and every slice are gone*/
+  std::shared_ptr<uint8_t> Release();
+};
+
+/*Size in bytes from which a `Buffer` is backed by transparent huge pages,
+4MiB by default*/
+std::size_t GetHugePageThreshold();
+void SetHugePageThreshold(std::size_t threshold);
+
 struct IndexTableAccessor;
+struct SWARIndexTableAccessor;
+struct AVX2IndexTableAccessor;
+struct VBMIIndexTableAccessor;
 
 extern const IndexTable kDefaultBase64;
 extern const IndexTable kUrlSafeBase64;
@@ -97,6 +250,52 @@ template <template <typename> class Container, typename T>
 Container<T> DecodeCTR(const Container<T>& input, const IndexTable& table,
                        bool padding = true);
 
+namespace Detail {
+  /*Containers that are taken by the allocator aware overloads below: the
+  allocator is their `allocator_type` and not the default one, which the
+  overloads above already take*/
+  template <typename C, typename T, typename Allocator>
+  using EnableIfAllocatorAware = std::enable_if_t<
+    std::is_same<typename C::allocator_type, Allocator>::value &&
+    !std::is_same<Allocator, std::allocator<T>>::value>;
+}
+
+/*Allocator aware overloads, e.g. for `std::pmr::vector` and
+`std::pmr::string`. The result is allocated with the allocator of `input`,
+so inputs from a `std::pmr::monotonic_buffer_resource` are coded without
+touching the global heap*/
+template <template <typename, typename> class Container, typename T,
+          typename Allocator,
+          typename = Detail::EnableIfAllocatorAware<Container<T, Allocator>,
+                                                    T, Allocator>>
+Container<T, Allocator> EncodeCTR(const Container<T, Allocator>& input,
+                                  const IndexTable& table,
+                                  bool padding = true);
+
+template <template <typename, typename> class Container, typename T,
+          typename Allocator,
+          typename = Detail::EnableIfAllocatorAware<Container<T, Allocator>,
+                                                    T, Allocator>>
+Container<T, Allocator> DecodeCTR(const Container<T, Allocator>& input,
+                                  const IndexTable& table,
+                                  bool padding = true);
+
+template <typename T, typename Traits, typename Allocator,
+          typename = std::enable_if_t<
+            !std::is_same<std::basic_string<T, Traits, Allocator>,
+                          std::basic_string<T>>::value>>
+std::basic_string<T, Traits, Allocator> EncodeCTR(
+  const std::basic_string<T, Traits, Allocator>& input,
+  const IndexTable& table, bool padding = true);
+
+template <typename T, typename Traits, typename Allocator,
+          typename = std::enable_if_t<
+            !std::is_same<std::basic_string<T, Traits, Allocator>,
+                          std::basic_string<T>>::value>>
+std::basic_string<T, Traits, Allocator> DecodeCTR(
+  const std::basic_string<T, Traits, Allocator>& input,
+  const IndexTable& table, bool padding = true);
+
 
 bool ValidPaddedEncodedLength(std::size_t encoded_length);
 bool ValidUnpaddedEncodedLength(std::size_t encoded_length);
@@ -106,9 +305,166 @@ std::size_t GetDecodedLength(std::size_t encoded_length, bool padding,
                              uint8_t padding_num = 0);
 
 void EncodeMem(uint8_t *dest, const uint8_t *src, std::size_t src_len,
-               const IndexTable& table, bool padding = true);
+               const IndexTable& table, bool padding = true,
+               StoreMode store_mode = StoreMode::kAuto);
 void DecodeMem(uint8_t *dest, const uint8_t *src, std::size_t src_len,
-               const IndexTable& table, bool padding = true);
+               const IndexTable& table, bool padding = true,
+               StoreMode store_mode = StoreMode::kAuto);
+
+/*`noexcept` forms of the above, `length` is the decoded length for
+`TryGetDecodedLength` and the number of bytes written to `dest` otherwise.
+The throwing functions are implemented on top of them*/
+Status TryGetDecodedLength(std::size_t encoded_length, bool padding,
+                           uint8_t padding_num = 0) noexcept;
+Status TryEncodeMem(uint8_t *dest, const uint8_t *src, std::size_t src_len,
+                    const IndexTable& table, bool padding = true,
+                    StoreMode store_mode = StoreMode::kAuto) noexcept;
+Status TryDecodeMem(uint8_t *dest, const uint8_t *src, std::size_t src_len,
+                    const IndexTable& table, bool padding = true,
+                    StoreMode store_mode = StoreMode::kAuto) noexcept;
+
+/*Decodes `len` characters at `data` over themselves, e.g. a network buffer
+that is not needed in its encoded form afterwards, and returns the number of
+decoded bytes at the start of `data`. `DecodeMem` accepts `dest == src` for
+the same reason: every kernel stores its output behind the characters it has
+already read. If an exception is thrown the contents of `data` are
+unspecified*/
+std::size_t DecodeInPlace(uint8_t *data, std::size_t len,
+                          const IndexTable& table, bool padding = true);
+
+/*Encodes the `data_len` bytes at the start of `buf` over themselves and
+returns the encoded length. `buf` has to hold `capacity` bytes, at least the
+encoded length, otherwise `kIllegalFunctionCall` is thrown. The buffer is
+encoded from its end backwards in blocks whose output lies past the bytes
+still to be read, so no second buffer of the encoded size is needed*/
+std::size_t EncodeInPlace(uint8_t *buf, std::size_t data_len,
+                          std::size_t capacity, const IndexTable& table,
+                          bool padding = true);
+
+/*Same as `EncodeMem` and `DecodeMem` into a new `Buffer` of the exact output
+size*/
+Buffer EncodeBuffer(const uint8_t *src, std::size_t src_len,
+                    const IndexTable& table, bool padding = true);
+Buffer DecodeBuffer(const uint8_t *src, std::size_t src_len,
+                    const IndexTable& table, bool padding = true);
+
+/*Same as `EncodeMem` and `DecodeMem` for a destination of `dest_capacity`
+bytes, e.g. a buffer reused between requests. The capacity is checked before
+anything is written and the number of written bytes is returned. Throws with
+`kIllegalFunctionCall` if the destination is too small*/
+std::size_t EncodeInto(uint8_t *dest, std::size_t dest_capacity,
+                       const uint8_t *src, std::size_t src_len,
+                       const IndexTable& table, bool padding = true,
+                       StoreMode store_mode = StoreMode::kAuto);
+std::size_t DecodeInto(uint8_t *dest, std::size_t dest_capacity,
+                       const uint8_t *src, std::size_t src_len,
+                       const IndexTable& table, bool padding = true,
+                       StoreMode store_mode = StoreMode::kAuto);
+
+#if defined(__cpp_lib_span)
+/*`std::span` forms of the above, only declared for C++20 and later*/
+std::size_t EncodeInto(std::span<uint8_t> dest, std::span<const uint8_t> src,
+                       const IndexTable& table, bool padding = true,
+                       StoreMode store_mode = StoreMode::kAuto);
+std::size_t DecodeInto(std::span<uint8_t> dest, std::span<const uint8_t> src,
+                       const IndexTable& table, bool padding = true,
+                       StoreMode store_mode = StoreMode::kAuto);
+#endif
+
+/*Decodes `src` while skipping every byte of `ignored`, e.g. the line breaks
+of MIME and PEM or the indentation of pretty printed input. None of them may
+be a character of `table`. Returns the number of decoded bytes, which is at
+most `src_len * 3 / 4`*/
+std::size_t DecodeSkippingMem(uint8_t *dest, const uint8_t *src,
+                              std::size_t src_len, const IndexTable& table,
+                              bool padding = true,
+                              const std::string& ignored = " \t\r\n");
+
+/*Exact number of bytes `DecodeSkippingMem` decodes from `src`, for sizing the
+destination before decoding. Throws like `GetDecodedLength` if the number of
+characters left after skipping is not a valid length*/
+std::size_t GetSkippingDecodedLength(const uint8_t *src, std::size_t src_len,
+                                     const IndexTable& table,
+                                     bool padding = true,
+                                     const std::string& ignored = " \t\r\n");
+
+/*Converts base64 encoded with `from_table` to `to_table` without decoding
+it, every character is validated and mapped in a single pass. The padding
+is replaced, added or removed as given by `to_padding`. Returns the number
+of characters written, at most `src_len + 2`*/
+std::size_t Transcode(uint8_t *dest, const uint8_t *src, std::size_t src_len,
+                      const IndexTable& from_table, const IndexTable& to_table,
+                      bool from_padding = true, bool to_padding = true);
+/*`noexcept` form of `Transcode`, `length` is the number of characters
+written*/
+Status TryTranscode(uint8_t *dest, const uint8_t *src, std::size_t src_len,
+                    const IndexTable& from_table, const IndexTable& to_table,
+                    bool from_padding = true, bool to_padding = true) noexcept;
+
+/*Encodes `count` buffers, the i-th starting at `src + src_offsets[i]` and
+`src_lengths[i]` bytes long, one after the other into `dest`. The offset of
+each encoded buffer is written to `dest_offsets[i]` and the total encoded
+length is returned. The SIMD kernels encode chunks of several buffers at
+once, which suits many small buffers. Empty buffers encode to nothing*/
+std::size_t EncodeBatchMem(uint8_t *dest, std::size_t *dest_offsets,
+                           const uint8_t *src, const std::size_t *src_offsets,
+                           const std::size_t *src_lengths, std::size_t count,
+                           const IndexTable& table, bool padding = true);
+
+std::size_t GetBatchEncodedLength(const std::size_t *src_lengths,
+                                  std::size_t count, bool padding);
+
+/*Checks if `src` would be decoded by `DecodeMem` without writing anything.
+Stops at the first violation and never throws*/
+ValidationResult Validate(const uint8_t *src, std::size_t src_len,
+                          const IndexTable& table, bool padding = true);
+
+/*Finds every maximal run of at least `min_length` characters of `table` in
+arbitrary text, e.g. the base64 of data URIs, JSON fields or log lines. With
+`padding`, up to two padding characters right after a run belong to it but do
+not count towards `min_length`. Runs are not checked any further: words of
+plain text made of table characters are found as well, and a run is only
+decoded by `DecodeMem` if its length is valid. The kernel classifies the
+text into bit masks, runs are read off their transitions*/
+std::vector<Base64Run> FindBase64Runs(const uint8_t *src, std::size_t src_len,
+                                      const IndexTable& table,
+                                      std::size_t min_length = 16,
+                                      bool padding = true);
+
+/*Encodes into lines of `line_length` characters separated by `separator`, as
+used by MIME (76, "\r\n") and PEM (64, "\n"). No separator follows the last
+line. The kernel encodes every line straight to its place in `dest` and
+writes the separators itself. An empty input writes nothing. `line_length`
+has to be a positive multiple of 4*/
+void EncodeWrappedMem(uint8_t *dest, const uint8_t *src, std::size_t src_len,
+                      const IndexTable& table, std::size_t line_length = 76,
+                      const std::string& separator = "\r\n",
+                      bool padding = true);
+
+std::size_t GetWrappedEncodedLength(std::size_t decoded_length, bool padding,
+                                    std::size_t line_length = 76,
+                                    std::size_t separator_length = 2);
+
+/*Same as `DecodeMem`, for keys and other secrets. The characters are turned
+into sextets with arithmetic on registers only, without table lookups or
+branches that depend on them, and invalid characters are only reported
+after the whole buffer has been decoded. Only the length and the number of
+padding characters, which are given away by the decoded length, are not
+hidden*/
+void DecodeConstantTimeMem(uint8_t *dest, const uint8_t *src,
+                           std::size_t src_len, const IndexTable& table,
+                           bool padding = true);
+
+/*Output length in bytes from which `StoreMode::kAuto` switches to streaming
+stores. It is the size of the last level cache of the host CPU, or 32MiB when
+the size cannot be read*/
+std::size_t GetStreamingThreshold();
+
+/*Name of the kernel used by `EncodeMem` and `DecodeMem`: "avx512vbmi", "avx2",
+"swar" or "default". It is picked once for the host CPU at the first call and
+can be pinned by setting the `MTBASE64_KERNEL` environment variable to one of
+the names. Unknown or unsupported names are ignored*/
+const char *GetKernelName();
 
 } /* MTBase64 */
 /*Import the template implementation file*/
@@ -19,60 +19,148 @@ namespace MTBase64 {
     return (a == padding) + (b == padding);
   }
 
+  namespace Detail {
+    template <typename C, typename = void>
+    struct HasResizeAndOverwrite : std::false_type {};
+
+    template <typename C>
+    struct HasResizeAndOverwrite<C, std::void_t<decltype(
+      std::declval<C&>().resize_and_overwrite(
+        std::size_t{},
+        std::declval<std::size_t (*)(typename C::value_type*, std::size_t)>()
+      ))>> : std::true_type {};
+
+    /*Sizes `output` to `size` elements and lets `code` write them through
+    `output.data()`. `code` returns the `Status` of a `Try` function, on
+    failure `output` is left empty and the error is thrown. Containers with
+    `resize_and_overwrite` (`std::string` since C++23) skip the zero
+    initialization of the new elements. Nothing may be thrown out of its
+    callback, so the error is only thrown after it returned*/
+    template <typename C, typename F>
+    void WriteInto(C& output, std::size_t size, F code) {
+      Status status{};
+      if constexpr (HasResizeAndOverwrite<C>::value) {
+        output.resize_and_overwrite(
+          size, [&](typename C::value_type *data, std::size_t) noexcept {
+            status = code(reinterpret_cast<uint8_t *>(data));
+            return status ? size : 0;
+          });
+      } else {
+        output.resize(size);
+        status = code(reinterpret_cast<uint8_t *>(output.data()));
+        if (!status)
+          output.clear();
+      }
+
+      if (!status)
+        throw MTBase64::MTBase64Exception(__FILE__, __FUNCTION__, __LINE__,
+                                          status.error_code,
+                                          status.error_message);
+    }
+
+    /*Encodes `input` straight into the empty `output`, which is only
+    allocated once and carries the allocator of the result*/
+    template <typename C>
+    C EncodeContainer(const C& input, C output, const IndexTable& table,
+                      bool padding) {
+      std::size_t encoded_length = MTBase64::GetEncodedLength(input.size(),
+                                                              padding);
+
+      WriteInto(output, encoded_length, [&](uint8_t *dest) {
+        return TryEncodeMem(dest,
+                            reinterpret_cast<const uint8_t *>(input.data()),
+                            input.size(), table, padding);
+      });
+
+      return output;
+    }
+
+    template <typename C>
+    C DecodeContainer(const C& input, C output, const IndexTable& table,
+                      bool padding) {
+
+      if ((padding && ((input.size() % 4) != 0)) ||
+          (!padding && ((input.size() % 4) == 1)))
+          throw MTBase64::MTBase64Exception(
+            __FILE__, __FUNCTION__, __LINE__,
+            MTBase64::ErrorCodeTable::kNotValidBase64,
+            "Not valid base64 encoding length");
+
+      uint8_t padding_num = GetPaddingNum(input, table);
+      std::size_t decoded_length = GetDecodedLength(input.size(), padding,
+                                                    padding_num);
+
+      WriteInto(output, decoded_length, [&](uint8_t *dest) {
+        return TryDecodeMem(dest,
+                            reinterpret_cast<const uint8_t *>(input.data()),
+                            input.size(), table, padding);
+      });
+
+      return output;
+    }
+  }
+
   template <template <typename> class Container, typename T>
   Container<T> EncodeCTR(const Container<T>& input, const IndexTable& table,
                         bool padding) {
-    size_t encoded_length = MTBase64::GetEncodedLength(input.size(),
-                                                       padding);
-    /* Trying to follow the strict aliansing rules of C++ using aligned malloc */
-    std::shared_ptr<uint8_t> encoded_buffer(static_cast<uint8_t*>(
-                                              std::aligned_alloc(
-                                                alignof(T),
-                                                encoded_length
-                                              )
-                                            ),
-                                            std::default_delete<uint8_t[]>());
-
-    EncodeMem(
-      encoded_buffer.get(), reinterpret_cast<const uint8_t *>(input.data()),
-      input.size(), table, padding);
-
-    Container<T> output(reinterpret_cast<T*>(encoded_buffer.get()),
-                        reinterpret_cast<T*>(encoded_buffer.get())+encoded_length);
-
-    return output;
+    return Detail::EncodeContainer(input, Container<T>(), table, padding);
   }
 
   template <template <typename> class Container, typename T>
   Container<T> DecodeCTR(const Container<T>& input, const IndexTable& table,
                           bool padding) {
+    return Detail::DecodeContainer(input, Container<T>(), table, padding);
+  }
+
+  template <template <typename, typename> class Container, typename T,
+            typename Allocator, typename>
+  Container<T, Allocator> EncodeCTR(const Container<T, Allocator>& input,
+                                    const IndexTable& table, bool padding) {
+    return Detail::EncodeContainer(
+      input, Container<T, Allocator>(input.get_allocator()), table, padding);
+  }
+
+  template <template <typename, typename> class Container, typename T,
+            typename Allocator, typename>
+  Container<T, Allocator> DecodeCTR(const Container<T, Allocator>& input,
+                                    const IndexTable& table, bool padding) {
+    return Detail::DecodeContainer(
+      input, Container<T, Allocator>(input.get_allocator()), table, padding);
+  }
+
+  template <typename T, typename Traits, typename Allocator, typename>
+  std::basic_string<T, Traits, Allocator> EncodeCTR(
+    const std::basic_string<T, Traits, Allocator>& input,
+    const IndexTable& table, bool padding) {
+    return Detail::EncodeContainer(
+      input, std::basic_string<T, Traits, Allocator>(input.get_allocator()),
+      table, padding);
+  }
+
+  template <typename T, typename Traits, typename Allocator, typename>
+  std::basic_string<T, Traits, Allocator> DecodeCTR(
+    const std::basic_string<T, Traits, Allocator>& input,
+    const IndexTable& table, bool padding) {
+    return Detail::DecodeContainer(
+      input, std::basic_string<T, Traits, Allocator>(input.get_allocator()),
+      table, padding);
+  }
+
+#if defined(__cpp_lib_span)
+  inline std::size_t EncodeInto(std::span<uint8_t> dest,
+                                std::span<const uint8_t> src,
+                                const IndexTable& table, bool padding,
+                                StoreMode store_mode) {
+    return EncodeInto(dest.data(), dest.size(), src.data(), src.size(), table,
+                      padding, store_mode);
+  }
 
-    if ((padding && ((input.size() % 4) != 0)) ||
-        (!padding && ((input.size() % 4) == 1)))
-        throw MTBase64::MTBase64Exception(
-          __FILE__, __FUNCTION__, __LINE__,
-          MTBase64::ErrorCodeTable::kNotValidBase64,
-          "Not valid base64 encoding length");
-
-    uint8_t padding_num = GetPaddingNum(input, table);
-    std::size_t decoded_length = GetDecodedLength(input.size(), padding,
-                                             padding_num);
-    /* Trying to follow the strict aliansing rules of C++ using aligned malloc */
-    std::shared_ptr<uint8_t> decoded_buffer(static_cast<uint8_t*>(
-                                              std::aligned_alloc(
-                                                alignof(T),
-                                                decoded_length
-                                              )
-                                            ),
-                                            std::default_delete<uint8_t[]>());
-
-    DecodeMem(
-      decoded_buffer.get(), reinterpret_cast<const uint8_t *>(input.data()),
-      input.size(), table, padding);
-
-    Container<T> output(reinterpret_cast<T*>(decoded_buffer.get()),
-                        reinterpret_cast<T*>(decoded_buffer.get())+decoded_length);
-
-    return output;
+  inline std::size_t DecodeInto(std::span<uint8_t> dest,
+                                std::span<const uint8_t> src,
+                                const IndexTable& table, bool padding,
+                                StoreMode store_mode) {
+    return DecodeInto(dest.data(), dest.size(), src.data(), src.size(), table,
+                      padding, store_mode);
   }
+#endif
 }
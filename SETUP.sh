@@ -5,22 +5,34 @@ script_failed() {
   exit 1;
 }
 
+# The C++17 tests and the same tests built as C++20 and C++23
+TESTS="build/TestCatch2 build/TestCatch2-c++20 build/TestCatch2-c++2b"
+
+# Runs the tests once with every kernel pinned, kernels that the CPU doesn't
+# support fall back to the fastest supported one
+run_tests() {
+  for test in $TESTS; do
+    for kernel in default swar avx2 avx512vbmi; do
+      MTBASE64_KERNEL=$kernel ./$test || script_failed
+    done
+  done
+}
+
 mkdir -p build/CPP_Headers 2> /dev/null
 
 option="${1}"
 case ${option} in
   all)
-    ninja build/TestCatch2;
-    ./build/TestCatch2 || script_failed
+    ninja $TESTS;
+    run_tests
 
     ninja build/libMTBase64.so build/MTBase64.a || script_failed
 
     cp MTBase64/MTBase64.hpp build/CPP_Headers/MTBase64.hpp
     cp MTBase64/MTBase64.tcc build/CPP_Headers/MTBase64.tcc
 
-    rm build/TestCatch2 2> /dev/null
-    rm build/MTBase64.o 2> /dev/null
-    rm build/MTBase64.so.o 2> /dev/null
+    rm $TESTS 2> /dev/null
+    rm build/*.o 2> /dev/null
 
     echo "SETUP.sh $1: \033[0;32mSCRIPT SUCCESS\033[0m";
     echo "\033[1;33mbuild/CPP_Headers/MTBase64.hpp: Main header file\033[0m"
@@ -38,16 +50,16 @@ case ${option} in
     exit 0
     ;;
   static)
-    ninja build/TestCatch2;
-    ./build/TestCatch2 || script_failed
+    ninja $TESTS;
+    run_tests
 
     ninja build/MTBase64.a || script_failed
 
     cp MTBase64/MTBase64.hpp build/CPP_Headers/MTBase64.hpp
     cp MTBase64/MTBase64.tcc build/CPP_Headers/MTBase64.tcc
 
-    rm build/TestCatch2 2> /dev/null
-    rm build/MTBase64.o 2> /dev/null
+    rm $TESTS 2> /dev/null
+    rm build/*.o 2> /dev/null
 
     echo "SETUP.sh $1: \033[0;32mSCRIPT SUCCESS\033[0m";
     echo "\033[1;33mbuild/CPP_Headers/MTBase64.hpp: Main header file\033[0m"
@@ -57,17 +69,16 @@ case ${option} in
     exit 0
     ;;
   shared)
-    ninja build/TestCatch2;
-    ./build/TestCatch2 || script_failed
+    ninja $TESTS;
+    run_tests
 
     ninja build/libMTBase64.so || script_failed
 
     cp MTBase64/MTBase64.hpp build/CPP_Headers/MTBase64.hpp
     cp MTBase64/MTBase64.tcc build/CPP_Headers/MTBase64.tcc
 
-    rm build/TestCatch2 2> /dev/null
-    rm build/MTBase64.so.o 2> /dev/null
-    rm build/MTBase64.o 2> /dev/null
+    rm $TESTS 2> /dev/null
+    rm build/*.o 2> /dev/null
 
     echo "SETUP.sh $1: \033[0;32mSCRIPT SUCCESS\033[0m";
     echo "\033[1;33mbuild/CPP_Headers/MTBase64.hpp: Main header file\033[0m"
@@ -30,13 +30,117 @@ DEALINGS IN THE SOFTWARE.
 #include <array>
 #include <memory>
 #include <string>
+#include <memory_resource>
 
 #include <cstring>
 #include <cstdint>
 
 #include "MTBase64.hpp"
+#include "Implementations/Implementations.hpp"
 
 
+/*Table that doesn't start with `A-Za-z0-9`, every character has the top bit
+set and no two of them are consecutive*/
+static std::array<uint8_t, 64> CustomArray() {
+  std::array<uint8_t, 64> custom_array;
+  for (int i = 0; i < 64; ++i)
+    custom_array[i] = static_cast<uint8_t>(0x80 + i * 2);
+  return custom_array;
+}
+
+/*Table that only differs from the default one in the last two characters*/
+static std::array<uint8_t, 64> SuffixArray() {
+  std::array<uint8_t, 64> suffix_array;
+  for (int i = 0; i < 64; ++i)
+    suffix_array[i] = MTBase64::kDefaultBase64.Lookup(i);
+  suffix_array[62] = '@';
+  suffix_array[63] = '~';
+  return suffix_array;
+}
+
+/*Table made of a few runs of consecutive characters in a different order*/
+static std::array<uint8_t, 64> RunsArray() {
+  std::array<uint8_t, 64> runs_array;
+  for (int i = 0; i < 64; ++i)
+    runs_array[i] = (i < 10) ? '0' + i : (i < 36) ? 'a' + i - 10 :
+                    (i < 62) ? 'A' + i - 36 : (i == 62) ? '.' : 0xC0;
+  return runs_array;
+}
+
+/*Bytes without a short period, so that every lane of a kernel sees
+different input*/
+static std::vector<uint8_t> TestBytes(std::size_t size) {
+  std::vector<uint8_t> src(size);
+  for (std::size_t i = 0; i < size; ++i)
+    src[i] = static_cast<uint8_t>((i * 167 + 13) ^ (i >> 3));
+  return src;
+}
+
+/*Encodes the first 1 to `src.size()` bytes of `src` with the kernel
+`Accessor` called directly, whichever kernel the dispatcher picked, and
+compares against the table implementation, also in lines. The output is
+decoded back with the same kernel, and characters outside of the table must
+be reported*/
+template <typename Accessor>
+static void RequireKernelRoundTrip(const MTBase64::IndexTable& table,
+                                   const std::vector<uint8_t>& src) {
+  for (std::size_t len = 1; len <= src.size(); ++len) {
+    for (bool padding : {true, false}) {
+      std::vector<uint8_t> expected(MTBase64::GetEncodedLength(len, padding));
+      MTBase64::IndexTableAccessor::EncodeBase64(expected.data(), src.data(),
+                                                 len, table, padding);
+
+      std::vector<uint8_t> encoded(expected.size());
+      Accessor::EncodeBase64(encoded.data(), src.data(), len, table, padding);
+      REQUIRE(encoded == expected);
+
+      std::vector<uint8_t> decoded(len);
+      REQUIRE(Accessor::DecodeBase64(decoded.data(), encoded.data(),
+                                     encoded.size(), table, padding) ==
+              nullptr);
+      REQUIRE(std::equal(decoded.begin(), decoded.end(), src.begin()));
+    }
+  }
+
+  /*Lines are compared against the plain encoding with a separator after
+  every `line_length` characters*/
+  const uint8_t separator[] = {'\r', '\n'};
+  for (std::size_t line_length : {4, 12, 28, 36, 64, 76}) {
+    for (std::size_t len = 1; len <= src.size(); ++len) {
+      std::vector<uint8_t> plain(MTBase64::GetEncodedLength(len, true));
+      MTBase64::IndexTableAccessor::EncodeBase64(plain.data(), src.data(), len,
+                                                 table, true);
+
+      std::vector<uint8_t> expected;
+      for (std::size_t i = 0; i < plain.size(); ++i) {
+        if (i > 0 && (i % line_length) == 0)
+          expected.insert(expected.end(), separator, separator + 2);
+        expected.push_back(plain[i]);
+      }
+
+      std::vector<uint8_t> wrapped(expected.size());
+      Accessor::EncodeWrappedBase64(wrapped.data(), src.data(), len, table,
+                                    line_length, separator, 2, true);
+      REQUIRE(wrapped == expected);
+    }
+  }
+
+  std::vector<uint8_t> encoded(MTBase64::GetEncodedLength(src.size(), true));
+  Accessor::EncodeBase64(encoded.data(), src.data(), src.size(), table, true);
+  std::vector<uint8_t> decoded(src.size());
+
+  for (std::size_t pos = 0; pos + 1 < encoded.size(); pos += 5) {
+    for (uint8_t bad : {0x00, 0xFF}) {
+      std::vector<uint8_t> corrupted(encoded);
+      corrupted[pos] = bad;
+
+      REQUIRE(Accessor::DecodeBase64(decoded.data(), corrupted.data(),
+                                     corrupted.size(), table, true) !=
+              nullptr);
+    }
+  }
+}
+
 
 
 TEST_CASE("Test MTBase64::IndexTable components", "[MTBase64::IndexTable]") {
@@ -508,6 +612,66 @@ TEST_CASE("Test MTBase64::EncodeCTR", "[MTBase64::EncodeCTR]") {
   }
 }
 
+TEST_CASE("Test MTBase64::EncodeCTR and MTBase64::DecodeCTR with allocators",
+          "[MTBase64::EncodeCTR]") {
+  /*Anything that is not taken from the arena fails*/
+  alignas(std::max_align_t) uint8_t arena_buffer[4096];
+  std::pmr::monotonic_buffer_resource arena(arena_buffer, sizeof(arena_buffer),
+                                            std::pmr::null_memory_resource());
+
+  SECTION("Test std::pmr::string") {
+    std::pmr::string decoded("Hello MTBase64!", &arena);
+
+    std::pmr::string encoded = MTBase64::EncodeCTR(decoded,
+                                                   MTBase64::kDefaultBase64);
+    REQUIRE(encoded == "SGVsbG8gTVRCYXNlNjQh");
+    REQUIRE(encoded.get_allocator().resource() == &arena);
+
+    std::pmr::string round_trip = MTBase64::DecodeCTR(encoded,
+                                                      MTBase64::kDefaultBase64);
+    REQUIRE(round_trip == decoded);
+    REQUIRE(round_trip.get_allocator().resource() == &arena);
+  }
+
+  SECTION("Test std::pmr::vector") {
+    std::pmr::vector<uint8_t> decoded({'d', 'e', 'f', 'h'}, &arena);
+
+    std::pmr::vector<uint8_t> encoded = MTBase64::EncodeCTR(
+      decoded, MTBase64::kUrlSafeBase64, false);
+    REQUIRE(encoded == std::pmr::vector<uint8_t>({'Z', 'G', 'V', 'm', 'a',
+                                                  'A'}));
+    REQUIRE(encoded.get_allocator().resource() == &arena);
+
+    std::pmr::vector<uint8_t> round_trip = MTBase64::DecodeCTR(
+      encoded, MTBase64::kUrlSafeBase64, false);
+    REQUIRE(round_trip == decoded);
+    REQUIRE(round_trip.get_allocator().resource() == &arena);
+  }
+}
+
+#if defined(__cpp_lib_string_resize_and_overwrite)
+/*Only built by the C++23 test target, where `std::string` is written through
+`resize_and_overwrite` whose callback must not throw*/
+TEST_CASE("Test MTBase64::DecodeCTR with resize_and_overwrite",
+          "[MTBase64::DecodeCTR]") {
+  std::string encoded(400, 'Q');
+  std::string decoded = MTBase64::DecodeCTR(encoded, MTBase64::kDefaultBase64);
+  REQUIRE(decoded.size() == 300);
+
+  encoded[321] = '.';
+  try {
+    decoded = MTBase64::DecodeCTR(encoded, MTBase64::kDefaultBase64);
+    FAIL("DecodeCTR did not throw");
+  } catch (const MTBase64::MTBase64Exception& e) {
+    REQUIRE(e.GetErrorCode() == MTBase64::ErrorCodeTable::kNotValidBase64);
+  }
+
+  REQUIRE_THROWS_AS(
+    MTBase64::EncodeCTR(std::string(), MTBase64::kDefaultBase64),
+    MTBase64::MTBase64Exception);
+}
+#endif
+
 TEST_CASE("Test MTBase64::DecodeStr", "[MTBase64::DecodeStr]") {
   const MTBase64::IndexTable table = MTBase64::kDefaultBase64;
 
@@ -965,3 +1129,1038 @@ TEST_CASE("Test MTBase64::DecodeMem", "[MTBase64::DecodeMem]") {
                         6) == 0);
   }
 }
+
+TEST_CASE("Test MTBase64::EncodeMem on long buffers",
+          "[MTBase64::EncodeMem]") {
+  const MTBase64::IndexTable custom_table(CustomArray());
+  const MTBase64::IndexTable suffix_table(SuffixArray());
+  const MTBase64::IndexTable runs_table(RunsArray());
+  const MTBase64::IndexTable* tables[] = {&MTBase64::kDefaultBase64,
+                                          &MTBase64::kUrlSafeBase64,
+                                          &custom_table, &suffix_table,
+                                          &runs_table};
+
+  const std::vector<uint8_t> src = TestBytes(300);
+
+  for (const MTBase64::IndexTable* table : tables) {
+    for (std::size_t len = 1; len <= src.size(); ++len) {
+      for (bool padding : {true, false}) {
+        /*Reference encoding built from single lookups*/
+        std::vector<uint8_t> expected;
+        for (std::size_t i = 0; i < len; i += 3) {
+          uint32_t chunk = src[i] << 16;
+          chunk |= (i + 1 < len) ? src[i + 1] << 8 : 0;
+          chunk |= (i + 2 < len) ? src[i + 2] : 0;
+
+          std::size_t chars = (i + 2 < len) ? 4 : (i + 1 < len) ? 3 : 2;
+          for (std::size_t c = 0; c < 4; ++c) {
+            if (c < chars)
+              expected.push_back(table->Lookup((chunk >> (18 - 6 * c)) & 0x3F));
+            else if (padding)
+              expected.push_back(table->GetPadding());
+          }
+        }
+
+        std::vector<uint8_t> dest(MTBase64::GetEncodedLength(len, padding));
+        REQUIRE(dest.size() == expected.size());
+
+        MTBase64::EncodeMem(dest.data(), src.data(), len, *table, padding);
+        REQUIRE(dest == expected);
+      }
+    }
+  }
+}
+
+TEST_CASE("Test MTBase64::DecodeMem on long buffers",
+          "[MTBase64::DecodeMem]") {
+  const MTBase64::IndexTable custom_table(CustomArray());
+  const MTBase64::IndexTable suffix_table(SuffixArray());
+  const MTBase64::IndexTable runs_table(RunsArray());
+  const MTBase64::IndexTable* tables[] = {&MTBase64::kDefaultBase64,
+                                          &MTBase64::kUrlSafeBase64,
+                                          &custom_table, &suffix_table,
+                                          &runs_table};
+
+  const std::vector<uint8_t> src = TestBytes(300);
+
+  for (const MTBase64::IndexTable* table : tables) {
+    for (std::size_t len = 1; len <= src.size(); ++len) {
+      for (bool padding : {true, false}) {
+        std::vector<uint8_t> encoded(MTBase64::GetEncodedLength(len, padding));
+        MTBase64::EncodeMem(encoded.data(), src.data(), len, *table, padding);
+
+        std::vector<uint8_t> decoded(len);
+        MTBase64::DecodeMem(decoded.data(), encoded.data(), encoded.size(),
+                            *table, padding);
+        REQUIRE(std::equal(decoded.begin(), decoded.end(), src.begin()));
+      }
+    }
+
+    SECTION("Test exceptions") {
+      std::vector<uint8_t> encoded(MTBase64::GetEncodedLength(src.size(), true));
+      MTBase64::EncodeMem(encoded.data(), src.data(), src.size(), *table, true);
+      std::vector<uint8_t> decoded(src.size());
+
+      /*Characters outside of the table and padding must be detected at any
+      position of the buffer. Padding is valid as the last character*/
+      for (std::size_t pos = 0; pos + 1 < encoded.size(); pos += 7) {
+        for (uint8_t bad : {static_cast<uint8_t>(0x00), table->GetPadding(),
+                            static_cast<uint8_t>(0xFF)}) {
+          std::vector<uint8_t> corrupted(encoded);
+          corrupted[pos] = bad;
+
+          REQUIRE_THROWS_AS(
+            MTBase64::DecodeMem(decoded.data(), corrupted.data(),
+                                corrupted.size(), *table, true),
+            MTBase64::MTBase64Exception);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Test MTBase64::DecodeInPlace", "[MTBase64::DecodeInPlace]") {
+  const MTBase64::IndexTable custom_table(CustomArray());
+  const MTBase64::IndexTable* tables[] = {&MTBase64::kDefaultBase64,
+                                          &MTBase64::kUrlSafeBase64,
+                                          &custom_table};
+
+  const std::vector<uint8_t> src = TestBytes(1000);
+
+  for (const MTBase64::IndexTable* table : tables) {
+    for (bool padding : {true, false}) {
+      for (std::size_t len = 1; len <= src.size(); len += (len < 200) ? 1 : 37) {
+        std::vector<uint8_t> data(MTBase64::GetEncodedLength(len, padding));
+        MTBase64::EncodeMem(data.data(), src.data(), len, *table, padding);
+
+        REQUIRE(MTBase64::DecodeInPlace(data.data(), data.size(), *table,
+                                        padding) == len);
+        REQUIRE(std::equal(src.begin(), src.begin() + len, data.begin()));
+
+        /*`DecodeMem` over its own input, also with the staging buffer of
+        the streaming stores*/
+        MTBase64::EncodeMem(data.data(), src.data(), len, *table, padding);
+        MTBase64::DecodeMem(data.data(), data.data(), data.size(), *table,
+                            padding, MTBase64::StoreMode::kStreaming);
+        REQUIRE(std::equal(src.begin(), src.begin() + len, data.begin()));
+      }
+    }
+  }
+
+  /*Several blocks of the staging buffer*/
+  std::vector<uint8_t> long_src(60000);
+  for (std::size_t i = 0; i < long_src.size(); ++i)
+    long_src[i] = static_cast<uint8_t>(i * 131 + (i >> 7));
+
+  std::vector<uint8_t> data(MTBase64::GetEncodedLength(long_src.size(), true));
+  MTBase64::EncodeMem(data.data(), long_src.data(), long_src.size(),
+                      MTBase64::kDefaultBase64);
+  MTBase64::DecodeMem(data.data(), data.data(), data.size(),
+                      MTBase64::kDefaultBase64, true,
+                      MTBase64::StoreMode::kStreaming);
+  REQUIRE(std::equal(long_src.begin(), long_src.end(), data.begin()));
+
+  std::string invalid("QUJD.EVG");
+  REQUIRE_THROWS_AS(
+    MTBase64::DecodeInPlace(reinterpret_cast<uint8_t*>(&invalid[0]),
+                            invalid.size(), MTBase64::kDefaultBase64),
+    MTBase64::MTBase64Exception);
+}
+
+TEST_CASE("Test MTBase64::EncodeInPlace", "[MTBase64::EncodeInPlace]") {
+  const std::vector<uint8_t> src = TestBytes(100000);
+
+  /*Short inputs are staged, long ones go through several blocks*/
+  for (std::size_t len : {1, 2, 3, 4, 5, 100, 9215, 9216, 9217, 9218, 12289,
+                          65537, 100000}) {
+    for (bool padding : {true, false}) {
+      std::vector<uint8_t> expected(MTBase64::GetEncodedLength(len, padding));
+      MTBase64::EncodeMem(expected.data(), src.data(), len,
+                          MTBase64::kUrlSafeBase64, padding);
+
+      std::vector<uint8_t> buf(src.begin(), src.begin() + len);
+      buf.resize(expected.size());
+      REQUIRE(MTBase64::EncodeInPlace(buf.data(), len, buf.size(),
+                                      MTBase64::kUrlSafeBase64, padding) ==
+              expected.size());
+      REQUIRE(buf == expected);
+
+      REQUIRE_THROWS_AS(
+        MTBase64::EncodeInPlace(buf.data(), len, expected.size() - 1,
+                                MTBase64::kUrlSafeBase64, padding),
+        MTBase64::MTBase64Exception);
+    }
+  }
+
+  /*Nothing to encode, nothing is written*/
+  uint8_t untouched = 0xAA;
+  REQUIRE(MTBase64::EncodeInPlace(&untouched, 0, 0,
+                                  MTBase64::kUrlSafeBase64) == 0);
+  REQUIRE(untouched == 0xAA);
+}
+
+TEST_CASE("Test MTBase64::Buffer", "[MTBase64::Buffer]") {
+  const std::vector<uint8_t> src = TestBytes(100000);
+
+  SECTION("Test encoding and decoding into buffers") {
+    for (std::size_t len : {1, 2, 3, 100, 100000}) {
+      MTBase64::Buffer encoded = MTBase64::EncodeBuffer(
+        src.data(), len, MTBase64::kDefaultBase64, true);
+      REQUIRE(encoded.size() == MTBase64::GetEncodedLength(len, true));
+      REQUIRE(reinterpret_cast<uintptr_t>(encoded.data()) % 64 == 0);
+
+      MTBase64::Buffer decoded = MTBase64::DecodeBuffer(
+        encoded.data(), encoded.size(), MTBase64::kDefaultBase64, true);
+      REQUIRE(decoded.size() == len);
+      REQUIRE(std::equal(decoded.begin(), decoded.end(), src.begin()));
+    }
+  }
+
+  SECTION("Test huge page backed buffers") {
+    std::size_t threshold = MTBase64::GetHugePageThreshold();
+    MTBase64::SetHugePageThreshold(1024);
+
+    MTBase64::Buffer encoded = MTBase64::EncodeBuffer(
+      src.data(), src.size(), MTBase64::kUrlSafeBase64, false);
+    MTBase64::SetHugePageThreshold(threshold);
+
+    REQUIRE(reinterpret_cast<uintptr_t>(encoded.data()) % (2 * 1024 * 1024)
+            == 0);
+    MTBase64::Buffer decoded = MTBase64::DecodeBuffer(
+      encoded.data(), encoded.size(), MTBase64::kUrlSafeBase64, false);
+    REQUIRE(std::equal(decoded.begin(), decoded.end(), src.begin(),
+                       src.end()));
+  }
+
+  SECTION("Test moving, slicing and releasing") {
+    MTBase64::Buffer buffer = MTBase64::EncodeBuffer(
+      src.data(), 300, MTBase64::kDefaultBase64, true);
+    std::vector<uint8_t> expected(buffer.begin(), buffer.end());
+
+    /*Slices keep the bytes alive after the buffer is gone*/
+    MTBase64::Buffer slice = buffer.Slice(100, 200);
+    REQUIRE(slice.data() == buffer.data() + 100);
+    REQUIRE_THROWS_AS(buffer.Slice(100, 301), MTBase64::MTBase64Exception);
+    REQUIRE_THROWS_AS(buffer.Slice(401, 0), MTBase64::MTBase64Exception);
+
+    MTBase64::Buffer moved(std::move(buffer));
+    REQUIRE(buffer.empty());
+    REQUIRE(moved.size() == expected.size());
+
+    MTBase64::Buffer& same = moved;
+    moved = std::move(same);
+    REQUIRE(moved.size() == expected.size());
+    REQUIRE(std::equal(moved.begin(), moved.end(), expected.begin()));
+
+    std::shared_ptr<uint8_t> released = moved.Release();
+    REQUIRE(moved.empty());
+    moved = MTBase64::Buffer();
+    REQUIRE(std::equal(released.get(), released.get() + expected.size(),
+                       expected.begin()));
+
+    released.reset();
+    REQUIRE(std::equal(slice.begin(), slice.end(), expected.begin() + 100));
+  }
+}
+
+TEST_CASE("Test MTBase64::EncodeInto and MTBase64::DecodeInto",
+          "[MTBase64::EncodeInto]") {
+  const std::vector<uint8_t> src = TestBytes(300);
+
+  /*Reused for every length like a per connection buffer*/
+  std::vector<uint8_t> encoded(MTBase64::GetEncodedLength(src.size(), true));
+  std::vector<uint8_t> decoded(src.size());
+
+  for (bool padding : {true, false}) {
+    for (std::size_t len = 1; len <= src.size(); ++len) {
+      std::size_t encoded_len = MTBase64::EncodeInto(
+        encoded.data(), encoded.size(), src.data(), len,
+        MTBase64::kDefaultBase64, padding);
+      REQUIRE(encoded_len == MTBase64::GetEncodedLength(len, padding));
+
+      std::size_t decoded_len = MTBase64::DecodeInto(
+        decoded.data(), decoded.size(), encoded.data(), encoded_len,
+        MTBase64::kDefaultBase64, padding);
+      REQUIRE(decoded_len == len);
+      REQUIRE(std::equal(decoded.begin(), decoded.begin() + len, src.begin()));
+
+      /*Too small destinations are rejected before anything is written*/
+      std::vector<uint8_t> small(encoded_len - 1, 0xAA);
+      REQUIRE_THROWS_AS(
+        MTBase64::EncodeInto(small.data(), small.size(), src.data(), len,
+                             MTBase64::kDefaultBase64, padding),
+        MTBase64::MTBase64Exception);
+
+      small.assign(len - 1, 0xAA);
+      REQUIRE_THROWS_AS(
+        MTBase64::DecodeInto(small.data(), small.size(), encoded.data(),
+                             encoded_len, MTBase64::kDefaultBase64, padding),
+        MTBase64::MTBase64Exception);
+      REQUIRE(std::all_of(small.begin(), small.end(),
+                          [](uint8_t byte) { return byte == 0xAA; }));
+    }
+  }
+
+#if defined(__cpp_lib_span)
+  SECTION("Test std::span overloads") {
+    std::size_t encoded_len = MTBase64::EncodeInto(
+      std::span<uint8_t>(encoded), std::span<const uint8_t>(src),
+      MTBase64::kDefaultBase64);
+    REQUIRE(MTBase64::DecodeInto(std::span<uint8_t>(decoded),
+                                 std::span<const uint8_t>(encoded.data(),
+                                                          encoded_len),
+                                 MTBase64::kDefaultBase64) == src.size());
+    REQUIRE(decoded == src);
+
+    std::vector<uint8_t> small(encoded_len - 1, 0xAA);
+    REQUIRE_THROWS_AS(
+      MTBase64::EncodeInto(std::span<uint8_t>(small),
+                           std::span<const uint8_t>(src),
+                           MTBase64::kDefaultBase64),
+      MTBase64::MTBase64Exception);
+
+    small.assign(src.size() - 1, 0xAA);
+    REQUIRE_THROWS_AS(
+      MTBase64::DecodeInto(std::span<uint8_t>(small),
+                           std::span<const uint8_t>(encoded.data(),
+                                                    encoded_len),
+                           MTBase64::kDefaultBase64),
+      MTBase64::MTBase64Exception);
+    REQUIRE(std::all_of(small.begin(), small.end(),
+                        [](uint8_t byte) { return byte == 0xAA; }));
+  }
+#endif
+}
+
+TEST_CASE("Test MTBase64::DecodeConstantTimeMem",
+          "[MTBase64::DecodeConstantTimeMem]") {
+  const MTBase64::IndexTable custom_table(CustomArray());
+  const MTBase64::IndexTable runs_table(RunsArray());
+  const MTBase64::IndexTable* tables[] = {&MTBase64::kDefaultBase64,
+                                          &MTBase64::kUrlSafeBase64,
+                                          &custom_table, &runs_table};
+
+  const std::vector<uint8_t> src = TestBytes(300);
+
+  for (const MTBase64::IndexTable* table : tables) {
+    for (std::size_t len = 1; len <= src.size(); ++len) {
+      for (bool padding : {true, false}) {
+        std::vector<uint8_t> encoded(MTBase64::GetEncodedLength(len, padding));
+        MTBase64::EncodeMem(encoded.data(), src.data(), len, *table, padding);
+
+        std::vector<uint8_t> decoded(len);
+        MTBase64::DecodeConstantTimeMem(decoded.data(), encoded.data(),
+                                        encoded.size(), *table, padding);
+        REQUIRE(std::equal(decoded.begin(), decoded.end(), src.begin()));
+      }
+    }
+
+    SECTION("Test exceptions") {
+      std::vector<uint8_t> encoded(MTBase64::GetEncodedLength(src.size(), true));
+      MTBase64::EncodeMem(encoded.data(), src.data(), src.size(), *table, true);
+      std::vector<uint8_t> decoded(src.size());
+
+      REQUIRE_THROWS_AS(
+        MTBase64::DecodeConstantTimeMem(decoded.data(), encoded.data(),
+                                        encoded.size() - 1, *table, true),
+        MTBase64::MTBase64Exception);
+
+      for (std::size_t pos = 0; pos + 1 < encoded.size(); pos += 7) {
+        for (uint8_t bad : {static_cast<uint8_t>(0x00), table->GetPadding(),
+                            static_cast<uint8_t>(0xFF)}) {
+          std::vector<uint8_t> corrupted(encoded);
+          corrupted[pos] = bad;
+
+          REQUIRE_THROWS_AS(
+            MTBase64::DecodeConstantTimeMem(decoded.data(), corrupted.data(),
+                                            corrupted.size(), *table, true),
+            MTBase64::MTBase64Exception);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Test MTBase64::EncodeBatchMem", "[MTBase64::EncodeBatchMem]") {
+  const MTBase64::IndexTable custom_table(CustomArray());
+  const MTBase64::IndexTable* tables[] = {&MTBase64::kDefaultBase64,
+                                          &custom_table};
+
+  const std::vector<uint8_t> src = TestBytes(8000);
+
+  /*Buffers of 0-60 bytes that overlap each other and end at the end of `src`*/
+  std::vector<std::size_t> src_offsets, src_lengths;
+  for (std::size_t i = 0; i < 300; ++i) {
+    src_lengths.push_back((i * 37) % 61);
+    src_offsets.push_back((i * 23) % (src.size() - 60));
+  }
+  src_lengths.push_back(60);
+  src_offsets.push_back(src.size() - 60);
+
+  for (const MTBase64::IndexTable* table : tables) {
+    for (bool padding : {true, false}) {
+      std::size_t count = src_lengths.size();
+      std::size_t total = MTBase64::GetBatchEncodedLength(src_lengths.data(),
+                                                          count, padding);
+      /*Nothing may be written past the last buffer*/
+      std::vector<uint8_t> dest(total + 64, 0xAA);
+      std::vector<std::size_t> dest_offsets(count);
+
+      REQUIRE(MTBase64::EncodeBatchMem(dest.data(), dest_offsets.data(),
+                                       src.data(), src_offsets.data(),
+                                       src_lengths.data(), count, *table,
+                                       padding) == total);
+      REQUIRE(std::all_of(dest.begin() + total, dest.end(),
+                          [](uint8_t byte) { return byte == 0xAA; }));
+
+      std::size_t offset = 0;
+      for (std::size_t i = 0; i < count; ++i) {
+        REQUIRE(dest_offsets[i] == offset);
+        if (src_lengths[i] == 0)
+          continue;
+
+        std::vector<uint8_t> expected(
+          MTBase64::GetEncodedLength(src_lengths[i], padding));
+        MTBase64::EncodeMem(expected.data(), src.data() + src_offsets[i],
+                            src_lengths[i], *table, padding);
+
+        REQUIRE(std::equal(expected.begin(), expected.end(),
+                           dest.begin() + offset));
+        offset += expected.size();
+      }
+    }
+  }
+}
+
+TEST_CASE("Test MTBase64 streaming stores", "[MTBase64::StoreMode]") {
+  /*Long enough for several staging chunks, written to unaligned destinations*/
+  const std::vector<uint8_t> src = TestBytes(40000);
+
+  REQUIRE(MTBase64::GetStreamingThreshold() > 0);
+
+  for (std::size_t len : {1, 2, 3, 9215, 9216, 9217, 18432, 20000, 40000}) {
+    for (bool padding : {true, false}) {
+      for (std::size_t offset : {0, 1, 13}) {
+        std::size_t encoded_length = MTBase64::GetEncodedLength(len, padding);
+        std::vector<uint8_t> cached(encoded_length);
+        std::vector<uint8_t> streamed(encoded_length + offset);
+
+        MTBase64::EncodeMem(cached.data(), src.data(), len,
+                            MTBase64::kDefaultBase64, padding,
+                            MTBase64::StoreMode::kCached);
+        MTBase64::EncodeMem(streamed.data() + offset, src.data(), len,
+                            MTBase64::kDefaultBase64, padding,
+                            MTBase64::StoreMode::kStreaming);
+        REQUIRE(std::equal(cached.begin(), cached.end(),
+                           streamed.begin() + offset));
+
+        std::vector<uint8_t> decoded(len + offset);
+        MTBase64::DecodeMem(decoded.data() + offset, cached.data(),
+                            encoded_length, MTBase64::kDefaultBase64, padding,
+                            MTBase64::StoreMode::kStreaming);
+        REQUIRE(std::equal(src.begin(), src.begin() + len,
+                           decoded.begin() + offset));
+      }
+    }
+  }
+
+  SECTION("Test exceptions") {
+    std::vector<uint8_t> encoded(MTBase64::GetEncodedLength(src.size(), true));
+    MTBase64::EncodeMem(encoded.data(), src.data(), src.size(),
+                        MTBase64::kDefaultBase64, true);
+    std::vector<uint8_t> decoded(src.size());
+
+    /*Padding inside of any chunk but the last one is rejected*/
+    for (std::size_t pos : {0, 1000, 16383, 16384, 30000}) {
+      std::vector<uint8_t> corrupted(encoded);
+      corrupted[pos] = '=';
+
+      REQUIRE_THROWS_AS(
+        MTBase64::DecodeMem(decoded.data(), corrupted.data(), corrupted.size(),
+                            MTBase64::kDefaultBase64, true,
+                            MTBase64::StoreMode::kStreaming),
+        MTBase64::MTBase64Exception);
+    }
+
+    REQUIRE_THROWS_AS(
+      MTBase64::DecodeMem(decoded.data(), encoded.data(), encoded.size() - 1,
+                          MTBase64::kDefaultBase64, true,
+                          MTBase64::StoreMode::kStreaming),
+      MTBase64::MTBase64Exception);
+    REQUIRE_THROWS_AS(
+      MTBase64::EncodeMem(encoded.data(), src.data(), 0,
+                          MTBase64::kDefaultBase64, true,
+                          MTBase64::StoreMode::kStreaming),
+      MTBase64::MTBase64Exception);
+  }
+}
+
+TEST_CASE("Test MTBase64::EncodeWrappedMem", "[MTBase64::EncodeWrappedMem]") {
+  const std::vector<uint8_t> src = TestBytes(30000);
+
+  SECTION("Test exceptions") {
+    std::vector<uint8_t> dest(1024);
+
+    REQUIRE_THROWS_AS(MTBase64::GetWrappedEncodedLength(10, true, 0, 2),
+                      MTBase64::MTBase64Exception);
+    REQUIRE_THROWS_AS(MTBase64::GetWrappedEncodedLength(10, true, 75, 2),
+                      MTBase64::MTBase64Exception);
+    REQUIRE_THROWS_AS(MTBase64::EncodeWrappedMem(dest.data(), src.data(), 10,
+                                                 MTBase64::kDefaultBase64, 6),
+                      MTBase64::MTBase64Exception);
+  }
+
+  SECTION("Test empty input") {
+    std::vector<uint8_t> dest(4, 0xAA);
+    MTBase64::EncodeWrappedMem(dest.data(), src.data(), 0,
+                               MTBase64::kDefaultBase64);
+    REQUIRE(dest == std::vector<uint8_t>(4, 0xAA));
+  }
+
+  SECTION("Test wrapped encoding length") {
+    REQUIRE(MTBase64::GetWrappedEncodedLength(0, true) == 0);
+    REQUIRE(MTBase64::GetWrappedEncodedLength(57, true) == 76);
+    REQUIRE(MTBase64::GetWrappedEncodedLength(58, true) == 76 + 2 + 4);
+    REQUIRE(MTBase64::GetWrappedEncodedLength(58, false) == 76 + 2 + 2);
+    REQUIRE(MTBase64::GetWrappedEncodedLength(96, true, 64, 1) == 128 + 1);
+  }
+
+  SECTION("Test encoding against a wrapped EncodeMem output") {
+    /*Short inputs and long ones of many lines. The line lengths cover lines
+    of an odd number of SWAR groups and ones shorter than, equal to and
+    longer than the blocks of the SIMD kernels*/
+    std::vector<std::size_t> lengths;
+    for (std::size_t len = 1; len <= 300; ++len)
+      lengths.push_back(len);
+    lengths.insert(lengths.end(), {9215, 9216, 9217, 27653});
+
+    for (std::size_t line_length : {4, 8, 12, 28, 32, 36, 64, 76, 16384}) {
+      for (const std::string separator : {"\r\n", "\n", ""}) {
+        for (bool padding : {true, false}) {
+          for (std::size_t len : lengths) {
+            std::vector<uint8_t> plain(MTBase64::GetEncodedLength(len,
+                                                                  padding));
+            MTBase64::EncodeMem(plain.data(), src.data(), len,
+                                MTBase64::kDefaultBase64, padding);
+
+            std::vector<uint8_t> expected;
+            for (std::size_t i = 0; i < plain.size(); ++i) {
+              if (i > 0 && (i % line_length) == 0)
+                expected.insert(expected.end(), separator.begin(),
+                                separator.end());
+              expected.push_back(plain[i]);
+            }
+
+            std::vector<uint8_t> wrapped(MTBase64::GetWrappedEncodedLength(
+              len, padding, line_length, separator.size()));
+            REQUIRE(wrapped.size() == expected.size());
+
+            MTBase64::EncodeWrappedMem(wrapped.data(), src.data(), len,
+                                       MTBase64::kDefaultBase64, line_length,
+                                       separator, padding);
+            REQUIRE(wrapped == expected);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Test MTBase64::DecodeSkippingMem", "[MTBase64::DecodeSkippingMem]") {
+  const MTBase64::IndexTable custom_table(CustomArray());
+  const MTBase64::IndexTable* tables[] = {&MTBase64::kDefaultBase64,
+                                          &MTBase64::kUrlSafeBase64,
+                                          &custom_table};
+
+  const std::vector<uint8_t> src = TestBytes(12000);
+
+  SECTION("Test exceptions") {
+    std::vector<uint8_t> dest(64);
+    const std::string spaces("  \r\n  \t ");
+    const std::string inner("QUJD=REVG");
+    const std::string with_table_char("QUJD");
+
+    REQUIRE_THROWS_AS(
+      MTBase64::DecodeSkippingMem(dest.data(),
+        reinterpret_cast<const uint8_t*>(spaces.data()), spaces.size(),
+        MTBase64::kDefaultBase64),
+      MTBase64::MTBase64Exception);
+    REQUIRE_THROWS_AS(
+      MTBase64::DecodeSkippingMem(dest.data(),
+        reinterpret_cast<const uint8_t*>(inner.data()), inner.size(),
+        MTBase64::kDefaultBase64),
+      MTBase64::MTBase64Exception);
+    REQUIRE_THROWS_AS(
+      MTBase64::DecodeSkippingMem(dest.data(),
+        reinterpret_cast<const uint8_t*>(with_table_char.data()),
+        with_table_char.size(), MTBase64::kDefaultBase64, true, " A"),
+      MTBase64::MTBase64Exception);
+    REQUIRE_THROWS_AS(
+      MTBase64::DecodeSkippingMem(dest.data(),
+        reinterpret_cast<const uint8_t*>(with_table_char.data()),
+        with_table_char.size(), MTBase64::kDefaultBase64, true, "="),
+      MTBase64::MTBase64Exception);
+  }
+
+  SECTION("Test decoding of wrapped and indented input") {
+    for (const MTBase64::IndexTable* table : tables) {
+      for (std::size_t len : {1, 2, 3, 57, 58, 100, 1000, 11999, 12000}) {
+        for (bool padding : {true, false}) {
+          std::vector<uint8_t> wrapped(
+            MTBase64::GetWrappedEncodedLength(len, padding, 64, 2));
+          MTBase64::EncodeWrappedMem(wrapped.data(), src.data(), len, *table,
+                                     64, "\r\n", padding);
+
+          /*Ignored bytes in runs of any length, also around the padding*/
+          std::vector<uint8_t> indented;
+          for (std::size_t i = 0; i < wrapped.size(); ++i) {
+            for (std::size_t j = 0; j < (i * 7) % 5; ++j)
+              indented.push_back((j % 2) ? ' ' : '\t');
+            indented.push_back(wrapped[i]);
+          }
+          indented.push_back('\n');
+
+          for (const std::vector<uint8_t>* input : {&wrapped, &indented}) {
+            std::vector<uint8_t> decoded(input->size() * 3 / 4);
+            std::size_t decoded_length = MTBase64::DecodeSkippingMem(
+              decoded.data(), input->data(), input->size(), *table, padding);
+
+            REQUIRE(decoded_length == len);
+            REQUIRE(std::equal(decoded.begin(), decoded.begin() + len,
+                               src.begin()));
+            REQUIRE(MTBase64::GetSkippingDecodedLength(
+              input->data(), input->size(), *table, padding) == len);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Test MTBase64::GetSkippingDecodedLength",
+          "[MTBase64::GetSkippingDecodedLength]") {
+  const std::string spaced_padding("QUJD\r\nRA = = \r\n");
+  const std::string trailing_whitespace("QUJDREU=\n\n\n");
+  const std::string only_whitespace(" \t\r\n");
+
+  REQUIRE(MTBase64::GetSkippingDecodedLength(
+    reinterpret_cast<const uint8_t*>(spaced_padding.data()),
+    spaced_padding.size(), MTBase64::kDefaultBase64) == 4);
+  REQUIRE(MTBase64::GetSkippingDecodedLength(
+    reinterpret_cast<const uint8_t*>(trailing_whitespace.data()),
+    trailing_whitespace.size(), MTBase64::kDefaultBase64) == 5);
+
+  REQUIRE_THROWS_AS(MTBase64::GetSkippingDecodedLength(
+    reinterpret_cast<const uint8_t*>(only_whitespace.data()),
+    only_whitespace.size(), MTBase64::kDefaultBase64),
+    MTBase64::MTBase64Exception);
+  REQUIRE_THROWS_AS(MTBase64::GetSkippingDecodedLength(
+    reinterpret_cast<const uint8_t*>(spaced_padding.data()),
+    spaced_padding.size(), MTBase64::kDefaultBase64, true, "\r\nA"),
+    MTBase64::MTBase64Exception);
+  /*Line feeds are counted as characters when they are not ignored*/
+  REQUIRE_THROWS_AS(MTBase64::GetSkippingDecodedLength(
+    reinterpret_cast<const uint8_t*>(trailing_whitespace.data()),
+    trailing_whitespace.size(), MTBase64::kDefaultBase64, true, " \t\r"),
+    MTBase64::MTBase64Exception);
+}
+
+TEST_CASE("Test MTBase64::Transcode", "[MTBase64::Transcode]") {
+  const MTBase64::IndexTable custom_table(CustomArray(), '*');
+  const MTBase64::IndexTable* tables[] = {&MTBase64::kDefaultBase64,
+                                          &MTBase64::kUrlSafeBase64,
+                                          &custom_table};
+
+  const std::vector<uint8_t> src = TestBytes(300);
+
+  SECTION("Test exceptions") {
+    std::vector<uint8_t> encoded(MTBase64::GetEncodedLength(src.size(), true));
+    MTBase64::EncodeMem(encoded.data(), src.data(), src.size(),
+                        MTBase64::kDefaultBase64, true);
+    std::vector<uint8_t> dest(encoded.size() + 2);
+
+    REQUIRE_THROWS_AS(
+      MTBase64::Transcode(dest.data(), encoded.data(), 0,
+                          MTBase64::kDefaultBase64, MTBase64::kUrlSafeBase64),
+      MTBase64::MTBase64Exception);
+    REQUIRE_THROWS_AS(
+      MTBase64::Transcode(dest.data(), encoded.data(), encoded.size() - 1,
+                          MTBase64::kDefaultBase64, MTBase64::kUrlSafeBase64),
+      MTBase64::MTBase64Exception);
+
+    /*Characters of an other table and padding are rejected anywhere but in
+    the padding at the end*/
+    for (std::size_t pos = 0; pos < encoded.size() - 2; pos += 5) {
+      for (uint8_t bad : {static_cast<uint8_t>('-'), static_cast<uint8_t>('='),
+                          static_cast<uint8_t>(0x80)}) {
+        std::vector<uint8_t> corrupted(encoded);
+        corrupted[pos] = bad;
+
+        REQUIRE_THROWS_AS(
+          MTBase64::Transcode(dest.data(), corrupted.data(), corrupted.size(),
+                              MTBase64::kDefaultBase64,
+                              MTBase64::kUrlSafeBase64),
+          MTBase64::MTBase64Exception);
+      }
+    }
+  }
+
+  SECTION("Test transcoding against encoding with the target table") {
+    for (const MTBase64::IndexTable* from : tables) {
+      for (const MTBase64::IndexTable* to : tables) {
+        for (bool from_padding : {true, false}) {
+          for (bool to_padding : {true, false}) {
+            for (std::size_t len = 1; len <= src.size(); ++len) {
+              std::vector<uint8_t> encoded(
+                MTBase64::GetEncodedLength(len, from_padding));
+              MTBase64::EncodeMem(encoded.data(), src.data(), len, *from,
+                                  from_padding);
+
+              std::vector<uint8_t> expected(
+                MTBase64::GetEncodedLength(len, to_padding));
+              MTBase64::EncodeMem(expected.data(), src.data(), len, *to,
+                                  to_padding);
+
+              std::vector<uint8_t> transcoded(encoded.size() + 2);
+              transcoded.resize(MTBase64::Transcode(
+                transcoded.data(), encoded.data(), encoded.size(), *from, *to,
+                from_padding, to_padding));
+              REQUIRE(transcoded == expected);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Test MTBase64::Validate", "[MTBase64::Validate]") {
+  const std::vector<uint8_t> src = TestBytes(300);
+
+  SECTION("Test reported violations") {
+    const std::string invalid_length("QUJDR");
+    const std::string invalid_char("QUJDRE.G");
+    const std::string inner_padding("QU=DREVG");
+    const std::string too_much_padding("QUJDR===");
+
+    MTBase64::ValidationResult result = MTBase64::Validate(
+      reinterpret_cast<const uint8_t*>(invalid_length.data()),
+      invalid_length.size(), MTBase64::kDefaultBase64, true);
+    REQUIRE(!result);
+    REQUIRE(result.error == MTBase64::ValidationError::kInvalidLength);
+
+    result = MTBase64::Validate(
+      reinterpret_cast<const uint8_t*>(invalid_char.data()),
+      invalid_char.size(), MTBase64::kDefaultBase64, true);
+    REQUIRE(result.error == MTBase64::ValidationError::kInvalidCharacter);
+    REQUIRE(result.offset == 6);
+
+    result = MTBase64::Validate(
+      reinterpret_cast<const uint8_t*>(inner_padding.data()),
+      inner_padding.size(), MTBase64::kDefaultBase64, true);
+    REQUIRE(result.error == MTBase64::ValidationError::kMisplacedPadding);
+    REQUIRE(result.offset == 2);
+
+    result = MTBase64::Validate(
+      reinterpret_cast<const uint8_t*>(too_much_padding.data()),
+      too_much_padding.size(), MTBase64::kDefaultBase64, true);
+    REQUIRE(result.error == MTBase64::ValidationError::kMisplacedPadding);
+    REQUIRE(result.offset == 5);
+  }
+
+  SECTION("Test validation against DecodeMem") {
+    for (bool padding : {true, false}) {
+      for (std::size_t len = 1; len <= src.size(); ++len) {
+        std::vector<uint8_t> encoded(MTBase64::GetEncodedLength(len, padding));
+        MTBase64::EncodeMem(encoded.data(), src.data(), len,
+                            MTBase64::kUrlSafeBase64, padding);
+
+        MTBase64::ValidationResult result = MTBase64::Validate(
+          encoded.data(), encoded.size(), MTBase64::kUrlSafeBase64, padding);
+        REQUIRE(result);
+        REQUIRE(result.offset == encoded.size());
+
+        /*The first violation is reported, whatever follows it*/
+        std::size_t pos = (len * 31) % MTBase64::GetEncodedLength(len, false);
+        encoded[pos] = '+';
+        encoded[encoded.size() - 1] = '/';
+
+        result = MTBase64::Validate(encoded.data(), encoded.size(),
+                                    MTBase64::kUrlSafeBase64, padding);
+        REQUIRE(result.error == MTBase64::ValidationError::kInvalidCharacter);
+        REQUIRE(result.offset == pos);
+
+        std::vector<uint8_t> decoded(len);
+        REQUIRE_THROWS_AS(
+          MTBase64::DecodeMem(decoded.data(), encoded.data(), encoded.size(),
+                              MTBase64::kUrlSafeBase64, padding),
+          MTBase64::MTBase64Exception);
+      }
+    }
+  }
+}
+
+TEST_CASE("Test MTBase64::FindBase64Runs", "[MTBase64::FindBase64Runs]") {
+  SECTION("Test runs in text") {
+    const std::string text("src=\"data:image/png;base64,iVBORw0KGgo=\" "
+                           "alt=\"QUJDREVGRw==\"");
+
+    auto runs = MTBase64::FindBase64Runs(
+      reinterpret_cast<const uint8_t*>(text.data()), text.size(),
+      MTBase64::kDefaultBase64, 10);
+    REQUIRE(runs.size() == 2);
+    REQUIRE(text.substr(runs[0].offset, runs[0].length) == "iVBORw0KGgo=");
+    REQUIRE(text.substr(runs[1].offset, runs[1].length) == "QUJDREVGRw==");
+
+    /*Without padding the runs stop at it and "image/png" is long enough*/
+    runs = MTBase64::FindBase64Runs(
+      reinterpret_cast<const uint8_t*>(text.data()), text.size(),
+      MTBase64::kDefaultBase64, 9, false);
+    REQUIRE(runs.size() == 3);
+    REQUIRE(text.substr(runs[0].offset, runs[0].length) == "image/png");
+    REQUIRE(text.substr(runs[1].offset, runs[1].length) == "iVBORw0KGgo");
+    REQUIRE(text.substr(runs[2].offset, runs[2].length) == "QUJDREVGRw");
+
+    REQUIRE_THROWS_AS(
+      MTBase64::FindBase64Runs(reinterpret_cast<const uint8_t*>(text.data()),
+                               text.size(), MTBase64::kDefaultBase64, 0),
+      MTBase64::MTBase64Exception);
+  }
+
+  SECTION("Test runs against a byte by byte search") {
+    /*Long enough for several blocks of masks, with runs of up to 300
+    characters crossing their boundaries*/
+    std::vector<uint8_t> text(40000);
+    std::size_t pos = 0;
+    for (std::size_t i = 0; pos < text.size(); ++i) {
+      std::size_t run = (i * 97) % 301, gap = (i * 13) % 5 + 1;
+      for (std::size_t j = 0; j < run && pos < text.size(); ++j)
+        text[pos++] = MTBase64::kUrlSafeBase64.Lookup((i + j * 7) % 64);
+      for (std::size_t j = 0; j < gap && pos < text.size(); ++j)
+        text[pos++] = (j % 2 == 0) ? '=' : '.';
+    }
+
+    std::array<bool, 256> is_char{};
+    for (uint8_t index = 0; index < 64; ++index)
+      is_char[MTBase64::kUrlSafeBase64.Lookup(index)] = true;
+
+    for (std::size_t len : {text.size(), std::size_t{12288}, std::size_t{64},
+                            std::size_t{63}, std::size_t{0}}) {
+      for (std::size_t min_length : {1, 16, 200}) {
+        for (bool padding : {true, false}) {
+          std::vector<MTBase64::Base64Run> expected;
+          for (std::size_t i = 0; i < len;) {
+            std::size_t end = i;
+            while (end < len && is_char[text[end]])
+              ++end;
+
+            if (end - i >= min_length) {
+              std::size_t padding_num = 0;
+              while (padding && padding_num < 2 && end + padding_num < len &&
+                     text[end + padding_num] == '=')
+                ++padding_num;
+              expected.push_back({i, end - i + padding_num});
+            }
+            i = end + 1;
+          }
+
+          auto runs = MTBase64::FindBase64Runs(
+            text.data(), len, MTBase64::kUrlSafeBase64, min_length, padding);
+          REQUIRE(runs.size() == expected.size());
+          for (std::size_t i = 0; i < runs.size(); ++i) {
+            REQUIRE(runs[i].offset == expected[i].offset);
+            REQUIRE(runs[i].length == expected[i].length);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Test MTBase64::TryDecodeMem", "[MTBase64::TryDecodeMem]") {
+  /*Longer than the staging buffer of the streaming stores*/
+  const std::vector<uint8_t> src = TestBytes(40000);
+
+  SECTION("Test reported errors against the throwing functions") {
+    const std::string invalid_length("QUJDR");
+    const std::string invalid_char("QUJDRE.G");
+    const std::string inner_padding("QU=DREVG");
+    uint8_t dest[8];
+
+    for (const std::string *input :
+         {&invalid_length, &invalid_char, &inner_padding}) {
+      const uint8_t *data = reinterpret_cast<const uint8_t*>(input->data());
+      MTBase64::Status status = MTBase64::TryDecodeMem(
+        dest, data, input->size(), MTBase64::kDefaultBase64);
+      REQUIRE(!status);
+      REQUIRE(status.error_code == MTBase64::ErrorCodeTable::kNotValidBase64);
+
+      try {
+        MTBase64::DecodeMem(dest, data, input->size(),
+                            MTBase64::kDefaultBase64);
+        FAIL("DecodeMem did not throw");
+      } catch (const MTBase64::MTBase64Exception& e) {
+        REQUIRE(e.GetErrorCode() == status.error_code);
+        REQUIRE(std::string(e.what()) == status.error_message);
+      }
+    }
+
+    MTBase64::Status status = MTBase64::TryEncodeMem(
+      dest, src.data(), 0, MTBase64::kDefaultBase64);
+    REQUIRE(!status);
+    REQUIRE(status.error_code ==
+            MTBase64::ErrorCodeTable::kIllegalFunctionCall);
+
+    status = MTBase64::TryGetDecodedLength(8, false, 1);
+    REQUIRE(status.error_code ==
+            MTBase64::ErrorCodeTable::kIllegalFunctionCall);
+    status = MTBase64::TryGetDecodedLength(8, true, 3);
+    REQUIRE(status.error_code ==
+            MTBase64::ErrorCodeTable::kIllegalFunctionCall);
+    status = MTBase64::TryGetDecodedLength(5, false);
+    REQUIRE(status.error_code == MTBase64::ErrorCodeTable::kNotValidBase64);
+    status = MTBase64::TryGetDecodedLength(7, true);
+    REQUIRE(status.error_code == MTBase64::ErrorCodeTable::kNotValidBase64);
+
+    const uint8_t *chars = reinterpret_cast<const uint8_t*>(
+      invalid_char.data());
+    status = MTBase64::TryTranscode(dest, chars, invalid_char.size(),
+                                    MTBase64::kDefaultBase64,
+                                    MTBase64::kUrlSafeBase64);
+    REQUIRE(status.error_code == MTBase64::ErrorCodeTable::kNotValidBase64);
+    REQUIRE_THROWS_AS(
+      MTBase64::Transcode(dest, chars, invalid_char.size(),
+                          MTBase64::kDefaultBase64, MTBase64::kUrlSafeBase64),
+      MTBase64::MTBase64Exception);
+
+    status = MTBase64::TryTranscode(dest, chars, 4, MTBase64::kDefaultBase64,
+                                    MTBase64::kUrlSafeBase64);
+    REQUIRE(status);
+    REQUIRE(status.length == 4);
+    REQUIRE(std::memcmp(dest, "QUJD", 4) == 0);
+  }
+
+  SECTION("Test round trips and invalid characters in every store mode") {
+    for (MTBase64::StoreMode store_mode :
+         {MTBase64::StoreMode::kCached, MTBase64::StoreMode::kStreaming}) {
+      for (bool padding : {true, false}) {
+        for (std::size_t len : {std::size_t{1}, std::size_t{2},
+                                std::size_t{100}, src.size() - 1}) {
+          std::vector<uint8_t> encoded(
+            MTBase64::GetEncodedLength(len, padding));
+          MTBase64::Status status = MTBase64::TryEncodeMem(
+            encoded.data(), src.data(), len, MTBase64::kUrlSafeBase64,
+            padding, store_mode);
+          REQUIRE(status);
+          REQUIRE(status.length == encoded.size());
+
+          std::vector<uint8_t> decoded(len);
+          status = MTBase64::TryDecodeMem(
+            decoded.data(), encoded.data(), encoded.size(),
+            MTBase64::kUrlSafeBase64, padding, store_mode);
+          REQUIRE(status);
+          REQUIRE(status.length == len);
+          REQUIRE(decoded == std::vector<uint8_t>(src.begin(),
+                                                  src.begin() + len));
+
+          encoded[(len * 31) % MTBase64::GetEncodedLength(len, false)] = '+';
+          status = MTBase64::TryDecodeMem(
+            decoded.data(), encoded.data(), encoded.size(),
+            MTBase64::kUrlSafeBase64, padding, store_mode);
+          REQUIRE(!status);
+          REQUIRE(status.error_code ==
+                  MTBase64::ErrorCodeTable::kNotValidBase64);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Test MTBase64::GetKernelName", "[MTBase64::GetKernelName]") {
+  std::string name(MTBase64::GetKernelName());
+
+  REQUIRE((name == "avx512vbmi" || name == "avx2" || name == "swar" ||
+           name == "default"));
+  /*The kernel is picked only once*/
+  REQUIRE(name == MTBase64::GetKernelName());
+}
+
+TEST_CASE("Test MTBase64::VBMIIndexTableAccessor",
+          "[MTBase64::VBMIIndexTableAccessor]") {
+  if (!MTBase64::VBMIIndexTableAccessor::Supported()) {
+    WARN("AVX-512 VBMI is not supported, the kernel is not tested");
+    return;
+  }
+
+  const MTBase64::IndexTable custom_table(CustomArray());
+
+  const std::vector<uint8_t> src = TestBytes(400);
+
+  for (const MTBase64::IndexTable* table : {&MTBase64::kDefaultBase64,
+                                            &MTBase64::kUrlSafeBase64,
+                                            &custom_table})
+    RequireKernelRoundTrip<MTBase64::VBMIIndexTableAccessor>(*table, src);
+}
+
+TEST_CASE("Test MTBase64::AVX2IndexTableAccessor with custom tables",
+          "[MTBase64::AVX2IndexTableAccessor]") {
+  if (!MTBase64::AVX2IndexTableAccessor::Supported()) {
+    WARN("AVX2 is not supported, the kernel is not tested");
+    return;
+  }
+
+  /*Neither table starts with `A-Za-z0-9`, so the encoder blends the rows of
+  the table instead of using the shift lookup*/
+  const MTBase64::IndexTable custom_table(CustomArray());
+  const MTBase64::IndexTable runs_table(RunsArray());
+
+  const std::vector<uint8_t> src = TestBytes(400);
+
+  for (const MTBase64::IndexTable* table : {&custom_table, &runs_table})
+    RequireKernelRoundTrip<MTBase64::AVX2IndexTableAccessor>(*table, src);
+}
+
+TEST_CASE("Test MTBase64::AVX2IndexTableAccessor gather decoding",
+          "[MTBase64::AVX2IndexTableAccessor]") {
+  if (!MTBase64::AVX2IndexTableAccessor::Supported()) {
+    WARN("AVX2 is not supported, the kernel is not tested");
+    return;
+  }
+
+  /*Tables of more than 8 runs of consecutive characters have no decode plan
+  and are decoded by gathering from `d0`..`d3`*/
+  const MTBase64::IndexTable custom_table(CustomArray());
+
+  std::array<uint8_t, 64> shuffled_array;
+  for (int i = 0; i < 64; ++i)
+    shuffled_array[i] = MTBase64::kDefaultBase64.Lookup((i * 37) % 64);
+  const MTBase64::IndexTable shuffled_table(shuffled_array);
+
+  const std::vector<uint8_t> src = TestBytes(400);
+
+  for (const MTBase64::IndexTable* table : {&custom_table, &shuffled_table}) {
+    RequireKernelRoundTrip<MTBase64::AVX2IndexTableAccessor>(*table, src);
+
+    /*The gathers must not overwrite characters that are not loaded yet*/
+    std::vector<uint8_t> buffer(MTBase64::GetEncodedLength(src.size(), true));
+    MTBase64::IndexTableAccessor::EncodeBase64(buffer.data(), src.data(),
+                                               src.size(), *table, true);
+    REQUIRE(MTBase64::AVX2IndexTableAccessor::DecodeBase64(
+              buffer.data(), buffer.data(), buffer.size(), *table, true) ==
+            nullptr);
+    REQUIRE(std::equal(src.begin(), src.end(), buffer.begin()));
+  }
+}
+
+TEST_CASE("Test MTBase64::SWARIndexTableAccessor",
+          "[MTBase64::SWARIndexTableAccessor]") {
+  const MTBase64::IndexTable custom_table(CustomArray());
+
+  const std::vector<uint8_t> src = TestBytes(400);
+
+  /*The SWAR kernel needs no instruction set, it is tested on every host*/
+  for (const MTBase64::IndexTable* table : {&MTBase64::kDefaultBase64,
+                                            &MTBase64::kUrlSafeBase64,
+                                            &custom_table})
+    RequireKernelRoundTrip<MTBase64::SWARIndexTableAccessor>(*table, src);
+}